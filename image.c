@@ -7,12 +7,21 @@
 
 #include "image.h"
 
+#include <ctype.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <png.h>
 #include <jpeglib.h>
+#include <zlib.h>
 
 void abort_(const char* s, ...) {
 	va_list args;
@@ -97,64 +106,517 @@ rsn_image read_jpeg_file(rsn_infop info,const char* filename) {
 	return image;
 }
 
-void write_png_file(rsn_info info,const char* filename, rsn_image image) {
-	FILE *f = fopen(filename, "wb");
-	if(!f) abort_("[write_png_file] File %s could not be opened for writing", filename);
+struct image_reader {
+	FILE* f;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	struct jpeg_decompress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	jvirt_barray_ptr* coefficients;
+	bool jpeg;
+	int row, width, channels;
+	rsn_line scratch;
+};
+
+image_reader open_png_reader(rsn_infop info, const char* filename) {
+	image_reader volatile r = calloc(1,sizeof(struct image_reader));
+	r->f = fopen(filename,"rb");
+	if(!r->f) abort_("[open_png_reader] File %s could not be opened for reading",filename);
+	unsigned char header[8];
+	fread(header,1,8,r->f);
+	if(png_sig_cmp(header,0,8)) abort_("[open_png_reader] File %s is not recognized as a PNG file",filename);
+
+	r->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if(!r->png_ptr) abort_("[open_png_reader] png_create_read_struct failed");
+	r->info_ptr = png_create_info_struct(r->png_ptr);
+	if(!r->info_ptr) abort_("[open_png_reader] png_create_info_struct failed");
+	if(setjmp(png_jmpbuf(r->png_ptr))) abort_("[open_png_reader] Error during init_io");
+
+	png_init_io(r->png_ptr,r->f);
+	png_set_sig_bytes(r->png_ptr,8);
+	png_read_info(r->png_ptr,r->info_ptr);
+	if(png_get_interlace_type(r->png_ptr,r->info_ptr) != PNG_INTERLACE_NONE) {
+		close_image_reader(r);
+		return NULL;
+	}
+	info->width = r->width = png_get_image_width(r->png_ptr,r->info_ptr);
+	info->height = png_get_image_height(r->png_ptr,r->info_ptr);
+	info->channels = r->channels = png_get_channels(r->png_ptr,r->info_ptr);
+	r->scratch = malloc(png_get_rowbytes(r->png_ptr,r->info_ptr));
+	return r;
+}
 
-	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if(!png_ptr) abort_("[write_png_file] png_create_write_struct failed");
+image_reader open_jpeg_reader(rsn_infop info, const char* filename) {
+	return open_jpeg_scaled_reader(info,filename,1);
+}
 
-	png_infop info_ptr = png_create_info_struct(png_ptr);
-	if(!info_ptr) abort_("[write_png_file] png_create_info_struct failed");
+/* libjpeg's reduced-size IDCT decodes at 1/denom scale (denom = 1, 2, 4 or 8) for a fraction of the full cost */
+image_reader open_jpeg_scaled_reader(rsn_infop info, const char* filename, int denom) {
+	image_reader r = calloc(1,sizeof(struct image_reader));
+	r->jpeg = true;
+	r->f = fopen(filename,"rb");
+	if(!r->f) abort_("Error opening jpeg file %s\n!",filename);
+
+	r->cinfo.err = jpeg_std_error(&r->jerr);
+	jpeg_create_decompress(&r->cinfo);
+	jpeg_stdio_src(&r->cinfo,r->f);
+	jpeg_read_header(&r->cinfo,TRUE);
+	r->cinfo.scale_num = 1;
+	r->cinfo.scale_denom = denom;
+	jpeg_start_decompress(&r->cinfo);
+
+	info->width = r->width = r->cinfo.output_width;
+	info->height = r->cinfo.output_height;
+	info->channels = r->channels = r->cinfo.num_components;
+	r->scratch = malloc(sizeof(rsn_pel)*r->width*r->channels);
+	return r;
+}
 
-	if(setjmp(png_jmpbuf(png_ptr))) abort_("[write_png_file] Error during init_io");
+/* A DC coefficient is 8 times the mean of its block (less the level shift), so the DC terms alone make a 1/8 scale
+   image without any IDCT, upsampling or full-size color conversion. Only grayscale and YCbCr are handled. */
+image_reader open_jpeg_dc_reader(rsn_infop info, const char* filename) {
+	image_reader r = calloc(1,sizeof(struct image_reader));
+	r->jpeg = true;
+	r->f = fopen(filename,"rb");
+	if(!r->f) abort_("Error opening jpeg file %s\n!",filename);
+
+	r->cinfo.err = jpeg_std_error(&r->jerr);
+	jpeg_create_decompress(&r->cinfo);
+	jpeg_stdio_src(&r->cinfo,r->f);
+	jpeg_read_header(&r->cinfo,TRUE);
+	if(r->cinfo.jpeg_color_space != JCS_GRAYSCALE && r->cinfo.jpeg_color_space != JCS_YCbCr) {
+		close_image_reader(r);
+		return NULL;
+	}
+	r->coefficients = jpeg_read_coefficients(&r->cinfo);
+
+	// A partial edge block covers image_width % 8 pixels, so it is kept only if it covers at least half of one
+	info->width = r->width = (r->cinfo.image_width+4)/8;
+	info->height = (r->cinfo.image_height+4)/8;
+	info->channels = r->channels = r->cinfo.num_components;
+	r->scratch = malloc(sizeof(rsn_pel)*r->width*r->channels);
+	return r;
+}
 
-	png_init_io(png_ptr,f);
+void read_dc_row(image_reader r, int y, rsn_line line) {
+	j_decompress_ptr cinfo = &r->cinfo;
+	for(int z = 0; z < r->channels; z++) {
+		jpeg_component_info* comp = cinfo->comp_info + z;
+		JBLOCKARRAY blocks = cinfo->mem->access_virt_barray((j_common_ptr)cinfo,r->coefficients[z],
+		                                                    y*comp->v_samp_factor/cinfo->max_v_samp_factor,1,FALSE);
+		for(int x = 0; x < r->width; x++) {
+			// Same descaling as libjpeg's 1x1 IDCT
+			int dc = ((blocks[0][x*comp->h_samp_factor/cinfo->max_h_samp_factor][0] * comp->quant_table->quantval[0] + 4) >> 3) + 128;
+			r->scratch[x*r->channels+z] = dc > 255 ? 255 : dc < 0 ? 0 : dc;
+		}
+	}
+	if(r->channels == 1) {
+		memcpy(line,r->scratch,r->width);
+		return;
+	}
+	for(int x = 0; x < r->width; x++) {
+		double Y = r->scratch[x*3], Cb = r->scratch[x*3+1]-128.0, Cr = r->scratch[x*3+2]-128.0;
+		double rgb[3] = {Y + 1.402*Cr, Y - 0.344136*Cb - 0.714136*Cr, Y + 1.772*Cb};
+		for(int z = 0; z < 3; z++)
+			line[x*3+z] = rgb[z] > 255 ? 255 : rgb[z] < 0 ? 0 : round(rgb[z]);
+	}
+}
+
+void read_image_row(void* reader, int y, rsn_line line) {
+	image_reader r = reader;
+	if(r->coefficients) {
+		read_dc_row(r,y,line);
+		return;
+	}
+	for(; r->row <= y; r->row++) {
+		rsn_line row = r->row == y ? line : r->scratch;
+		if(r->jpeg) jpeg_read_scanlines(&r->cinfo,&row,1);
+		else {
+			if(setjmp(png_jmpbuf(r->png_ptr))) abort_("[read_image_row] Error during read_row");
+			png_read_row(r->png_ptr,row,NULL);
+		}
+	}
+}
+
+/* Rows past the region of interest are never decoded, so decoding is abandoned rather than finished */
+void close_image_reader(image_reader r) {
+	if(r->jpeg) jpeg_destroy_decompress(&r->cinfo);
+	else png_destroy_read_struct(&r->png_ptr,&r->info_ptr,NULL);
+	fclose(r->f);
+	free(r->scratch);
+	free(r);
+}
+
+struct image_writer {
+	FILE* f;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	bool jpeg;
+	/* Parallel PNG: rows are buffered a batch of strips at a time behind the last row of the previous batch */
+	png_options options;
+	int channels, width, height, strip, buffered;
+	unsigned char* raw,* filtered,* window;
+	size_t windowlen;
+	uLong adler;
+};
+
+void write_png_chunk(FILE* f, const char* type, const unsigned char* data, uint32_t length) {
+	unsigned char be[4] = {length >> 24,length >> 16,length >> 8,length};
+	fwrite(be,1,4,f);
+	fwrite(type,1,4,f);
+	if(length) fwrite(data,1,length,f); // IEND has no buffer at all
+	uint32_t crc = crc32(0,(const Bytef*)type,4);
+	if(length) crc = crc32(crc,data,length); // A NULL buffer would reset it
+	be[0] = crc >> 24; be[1] = crc >> 16; be[2] = crc >> 8; be[3] = crc;
+	fwrite(be,1,4,f);
+}
+
+/* The parallel writer produces the PNG itself. Each strip is its own raw deflate stream primed with the 32K of
+   filtered data before it and ended with a sync flush, so the strips concatenate into one zlib stream, whose
+   checksum is pieced together with adler32_combine. Strips are sized for ~128K of input, where priming keeps the
+   size within a fraction of a percent of a single stream. */
+image_writer open_parallel_png_writer(image_writer w, rsn_info info, int ocsp, png_options options) {
+	static const unsigned char signature[8] = {137,80,78,71,13,10,26,10};
+	w->options = options;
+	if(w->options.level < 0) w->options.level = Z_DEFAULT_COMPRESSION;
+	if(!w->options.filters) w->options.filters = PNG_ALL_FILTERS;
+	if(w->options.strategy < 0) w->options.strategy = w->options.filters == PNG_FILTER_NONE ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+	w->channels = info.channels;
+	w->width = info.width_s;
+	w->height = info.height_s;
+	size_t stride = (size_t)w->width*w->channels;
+	w->strip = (1 << 17) / (stride+1);
+	if(w->strip < 1) w->strip = 1;
+	w->raw = calloc((size_t)(w->strip*options.threads+1),stride);
+	w->filtered = malloc((size_t)w->strip*options.threads*(stride+1));
+	w->window = malloc(1 << 15);
+	w->adler = adler32(0,NULL,0);
+
+	unsigned char ihdr[13] = {w->width >> 24,w->width >> 16,w->width >> 8,w->width,
+	                          w->height >> 24,w->height >> 16,w->height >> 8,w->height,8,ocsp,0,0,0};
+	fwrite(signature,1,8,w->f);
+	write_png_chunk(w->f,"IHDR",ihdr,13);
+	return w;
+}
+
+image_writer open_png_writer(rsn_info info, const char* filename, png_options options) {
+	image_writer w = calloc(1,sizeof(struct image_writer));
+	w->f = fopen(filename, "wb");
+	if(!w->f) abort_("[write_png_file] File %s could not be opened for writing", filename);
 
-	if(setjmp(png_jmpbuf(png_ptr))) abort_("[write_png_file] Error during writing header");
 	int ocsp;
 	if(!(info.channels % 2)) ocsp = (info.channels - 2) | PNG_COLOR_MASK_ALPHA;
 	else ocsp = info.channels - 1;
-	png_set_IHDR(png_ptr,info_ptr,info.width_s,info.height_s,8,ocsp,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_BASE);
+	if(options.threads > 1) return open_parallel_png_writer(w,info,ocsp,options);
 
-	png_write_info(png_ptr,info_ptr);
+	w->png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if(!w->png_ptr) abort_("[write_png_file] png_create_write_struct failed");
 
-	if(setjmp(png_jmpbuf(png_ptr))) abort_("[write_png_file] Error during writing bytes");
+	w->info_ptr = png_create_info_struct(w->png_ptr);
+	if(!w->info_ptr) abort_("[write_png_file] png_create_info_struct failed");
 
-	png_write_image(png_ptr,image);
+	if(setjmp(png_jmpbuf(w->png_ptr))) abort_("[write_png_file] Error during init_io");
 
-	if(setjmp(png_jmpbuf(png_ptr))) abort_("[write_png_file] Error during end of write");
-	png_write_end(png_ptr,NULL);
-	fclose(f);
-	png_destroy_write_struct(&png_ptr,&info_ptr);
-	png_destroy_info_struct(png_ptr,&info_ptr);
+	png_init_io(w->png_ptr,w->f);
+	if(options.level >= 0) png_set_compression_level(w->png_ptr,options.level);
+	if(options.strategy >= 0) png_set_compression_strategy(w->png_ptr,options.strategy);
+	if(options.filters) png_set_filter(w->png_ptr,PNG_FILTER_TYPE_BASE,options.filters);
+
+	if(setjmp(png_jmpbuf(w->png_ptr))) abort_("[write_png_file] Error during writing header");
+	png_set_IHDR(w->png_ptr,w->info_ptr,info.width_s,info.height_s,8,ocsp,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_BASE);
+
+	png_write_info(w->png_ptr,w->info_ptr);
+	return w;
+}
+
+int paeth(int a, int b, int c) {
+	int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+/* Filters a row the way libpng chooses: a lone allowed filter is used as-is, otherwise the one leaving the smallest
+   sum of absolute (signed) residuals. out receives the filter byte followed by the residuals. */
+void png_filter_row(const unsigned char* row, const unsigned char* prev, size_t length, int bpp, int filters, unsigned char* out) {
+	unsigned char trial[length];
+	unsigned long best = -1;
+	for(int type = 0; type < 5; type++) {
+		if(!(filters & (PNG_FILTER_NONE << type))) continue;
+		unsigned long sum = 0;
+		for(size_t i = 0; i < length; i++) {
+			int a = i >= (size_t)bpp ? row[i-bpp] : 0, b = prev[i], c = i >= (size_t)bpp ? prev[i-bpp] : 0;
+			switch(type) {
+				case 0 : trial[i] = row[i];                 break;
+				case 1 : trial[i] = row[i] - a;             break;
+				case 2 : trial[i] = row[i] - b;             break;
+				case 3 : trial[i] = row[i] - (a + b) / 2;   break;
+				case 4 : trial[i] = row[i] - paeth(a,b,c);  break;
+			}
+			sum += abs((signed char)trial[i]);
+		}
+		if(sum < best) {
+			best = sum;
+			out[0] = type;
+			memcpy(out+1,trial,length);
+		}
+	}
+}
+
+/* Filters and deflates the buffered rows across the pool and appends them as IDAT chunks in order */
+void flush_png_strips(image_writer w, bool last) {
+	size_t stride = (size_t)w->width*w->channels;
+	int rows = w->buffered, strips = (rows + w->strip - 1) / w->strip;
+	bool first = !w->windowlen;
+	unsigned char* out[strips];
+	size_t lengths[strips];
+	uLong adlers[strips];
+
+#if RSN_IS_THREADED
+#pragma omp parallel for num_threads(w->options.threads)
+#endif
+	for(int y = 0; y < rows; y++)
+		png_filter_row(w->raw + (y+1)*stride,w->raw + y*stride,stride,w->channels,w->options.filters,w->filtered + y*(stride+1));
+
+#if RSN_IS_THREADED
+#pragma omp parallel for num_threads(w->options.threads)
+#endif
+	for(int s = 0; s < strips; s++) {
+		unsigned char* in = w->filtered + (size_t)s*w->strip*(stride+1);
+		size_t length = (size_t)((s == strips-1 ? rows - s*w->strip : w->strip))*(stride+1);
+		z_stream z = {0};
+		deflateInit2(&z,w->options.level,Z_DEFLATED,-15,8,w->options.strategy);
+		if(s) {
+			size_t dictlen = (size_t)s*w->strip*(stride+1) < (1 << 15) ? (size_t)s*w->strip*(stride+1) : (1 << 15);
+			deflateSetDictionary(&z,in - dictlen,dictlen);
+		}
+		else if(w->windowlen) deflateSetDictionary(&z,w->window,w->windowlen);
+		/* Two bytes ahead for the zlib header and four behind for the checksum */
+		size_t bound = deflateBound(&z,length) + 64;
+		out[s] = malloc(bound + 6);
+		z.next_in = in;
+		z.avail_in = length;
+		z.next_out = out[s] + 2;
+		z.avail_out = bound;
+		deflate(&z,last && s == strips-1 ? Z_FINISH : Z_SYNC_FLUSH);
+		lengths[s] = bound - z.avail_out;
+		deflateEnd(&z);
+		adlers[s] = adler32(1,in,length);
+	}
+
+	for(int s = 0; s < strips; s++) {
+		size_t length = (size_t)((s == strips-1 ? rows - s*w->strip : w->strip))*(stride+1);
+		unsigned char* chunk = out[s] + 2;
+		w->adler = adler32_combine(w->adler,adlers[s],length);
+		if(first && !s) {
+			int level = w->options.level < 0 ? 6 : w->options.level;
+			chunk = out[s];
+			chunk[0] = 0x78;
+			chunk[1] = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+			chunk[1] += 31 - (chunk[0]*256 + chunk[1]) % 31;
+			lengths[s] += 2;
+		}
+		if(last && s == strips-1) {
+			unsigned char* tail = chunk + lengths[s];
+			tail[0] = w->adler >> 24; tail[1] = w->adler >> 16; tail[2] = w->adler >> 8; tail[3] = w->adler;
+			lengths[s] += 4;
+		}
+		write_png_chunk(w->f,"IDAT",chunk,lengths[s]);
+		free(out[s]);
+	}
+
+	/* Keep the dictionary for the next batch and the row the next batch filters against */
+	size_t total = (size_t)rows*(stride+1);
+	if(total >= (1 << 15)) memcpy(w->window,w->filtered + total - (1 << 15),w->windowlen = 1 << 15);
+	else {
+		size_t keep = w->windowlen + total > (1 << 15) ? (1 << 15) - total : w->windowlen;
+		memmove(w->window,w->window + w->windowlen - keep,keep);
+		memcpy(w->window + keep,w->filtered,total);
+		w->windowlen = keep + total;
+	}
+	memcpy(w->raw,w->raw + rows*stride,stride);
+	w->buffered = 0;
+}
+
+image_writer open_jpeg_writer(rsn_info info, const char* filename, int quality) {
+	image_writer w = calloc(1,sizeof(struct image_writer));
+	w->jpeg = true;
+	w->f = fopen(filename,"wb");
+	if(!w->f) abort_("Error opening output jpeg file %s\n!",filename);
+
+	w->cinfo.err = jpeg_std_error(&w->jerr);
+	jpeg_create_compress(&w->cinfo);
+	jpeg_stdio_dest(&w->cinfo,w->f);
+
+	w->cinfo.image_width = info.width_s;
+	w->cinfo.image_height = info.height_s;
+	w->cinfo.input_components = info.channels;
+	w->cinfo.in_color_space = (int)ceil(info.channels/2.f);
+
+	jpeg_set_defaults(&w->cinfo);
+	jpeg_set_quality(&w->cinfo,quality,TRUE);
+
+	jpeg_start_compress(&w->cinfo,TRUE);
+	return w;
+}
+
+void write_image_row(void* writer, int y, rsn_line line) {
+	image_writer w = writer;
+	if(w->jpeg) jpeg_write_scanlines(&w->cinfo,&line,1);
+	else if(w->raw) {
+		memcpy(w->raw + (size_t)(++w->buffered)*w->width*w->channels,line,sizeof(rsn_pel)*w->width*w->channels);
+		if(y == w->height-1 || w->buffered == w->strip*w->options.threads) flush_png_strips(w,y == w->height-1);
+	}
+	else {
+		if(setjmp(png_jmpbuf(w->png_ptr))) abort_("[write_png_file] Error during writing bytes");
+		png_write_row(w->png_ptr,line);
+	}
+}
+
+void close_image_writer(image_writer w) {
+	if(w->jpeg) {
+		jpeg_finish_compress(&w->cinfo);
+		jpeg_destroy_compress(&w->cinfo);
+	}
+	else if(w->raw) {
+		write_png_chunk(w->f,"IEND",NULL,0);
+		free(w->raw);
+		free(w->filtered);
+		free(w->window);
+	}
+	else {
+		if(setjmp(png_jmpbuf(w->png_ptr))) abort_("[write_png_file] Error during end of write");
+		png_write_end(w->png_ptr,NULL);
+		png_destroy_write_struct(&w->png_ptr,&w->info_ptr);
+	}
+	fclose(w->f);
+	free(w);
+}
+
+void write_png_file(rsn_info info, const char* filename, rsn_image image, png_options options) {
+	image_writer w = open_png_writer(info,filename,options);
+	for(int y = 0; y < info.height_s; y++)
+		write_image_row(w,y,image[y]);
+	close_image_writer(w);
 }
 
 void write_jpeg_file(rsn_info info, const char* filename, rsn_image image, int quality) {
-	FILE* f = fopen(filename,"wb");
-	if(!f) abort_("Error opening output jpeg file %s\n!",filename);
+	image_writer w = open_jpeg_writer(info,filename,quality);
+	for(int y = 0; y < info.height_s; y++)
+		write_image_row(w,y,image[y]);
+	close_image_writer(w);
+}
 
-	struct jpeg_compress_struct cinfo;
-	struct jpeg_error_mgr jerr;
+/* Reads the next unsigned integer of a PNM header, skipping whitespace and comments */
+int pnm_header_int(const char** p, const char* end) {
+	while(*p < end && (isspace(**p) || **p == '#'))
+		if(*(*p)++ == '#')
+			while(*p < end && **p != '\n') (*p)++;
+	int n = 0;
+	for(; *p < end && isdigit(**p); (*p)++)
+		n = n*10 + **p - '0';
+	return n;
+}
 
-	cinfo.err = jpeg_std_error(&jerr);
-	jpeg_create_compress(&cinfo);
-	jpeg_stdio_dest(&cinfo,f);
+/* Steps past word if the header continues with it */
+bool pnm_header_keyword(const char** p, const char* end, const char* word) {
+	size_t length = strlen(word);
+	if((size_t)(end - *p) < length || strncmp(*p,word,length)) return false;
+	*p += length;
+	return true;
+}
 
-	cinfo.image_width = info.width_s;
-	cinfo.image_height = info.height_s;
-	cinfo.input_components = info.channels;
-	cinfo.in_color_space = (int)ceil(info.channels/2.f);
+image_map map_pnm_file(rsn_infop info, const char* filename) {
+	int fd = open(filename,O_RDONLY);
+	if(fd < 0) abort_("[map_pnm_file] File %s could not be opened for reading",filename);
+	struct stat st;
+	if(fstat(fd,&st)) abort_("[map_pnm_file] File %s could not be opened for reading",filename);
+	image_map m = calloc(1,sizeof(struct image_map));
+	m->length = st.st_size;
+	m->map = mmap(NULL,m->length,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(m->map == MAP_FAILED) abort_("[map_pnm_file] File %s could not be mapped",filename);
+
+	const char* p = m->map,* end = p + m->length;
+	int maxval = 0;
+	if(m->length < 3 || p[0] != 'P') abort_("[map_pnm_file] File %s is not recognized as a PNM file",filename);
+	switch(p[1]) {
+		case '5' :
+		case '6' :
+			p += 2;
+			info->channels = p[-1] == '5' ? 1 : 3;
+			info->width = pnm_header_int(&p,end);
+			info->height = pnm_header_int(&p,end);
+			maxval = pnm_header_int(&p,end);
+			p++; // Single whitespace before the raster
+			break;
+		case '7' :
+			for(p += 2; p < end;) {
+				while(p < end && isspace(*p)) p++;
+				if(p == end) p++; // No ENDHDR, so the header is truncated
+				else if(*p == '#') while(p < end && *p != '\n') p++;
+				else if(pnm_header_keyword(&p,end,"ENDHDR")) {
+					const char* eol = memchr(p,'\n',end-p);
+					p = eol ? eol + 1 : end + 1;
+					break;
+				}
+				else if(pnm_header_keyword(&p,end,"WIDTH"))  info->width = pnm_header_int(&p,end);
+				else if(pnm_header_keyword(&p,end,"HEIGHT")) info->height = pnm_header_int(&p,end);
+				else if(pnm_header_keyword(&p,end,"DEPTH"))  info->channels = pnm_header_int(&p,end);
+				else if(pnm_header_keyword(&p,end,"MAXVAL")) maxval = pnm_header_int(&p,end);
+				else while(p < end && *p != '\n') p++; // TUPLTYPE and anything unknown
+			}
+			break;
+		default : abort_("[map_pnm_file] File %s is not a binary PGM, PPM or PAM file",filename);
+	}
+	if(maxval != 255) abort_("[map_pnm_file] File %s is not 8 bits per sample",filename);
+	if(info->channels < 1 || info->channels > 4) abort_("[map_pnm_file] File %s does not have 1 to 4 channels",filename);
+	size_t stride = (size_t)info->width*info->channels;
+	if(p > end || (size_t)(end - p) < stride*info->height) abort_("[map_pnm_file] File %s is truncated",filename);
 
-	jpeg_set_defaults(&cinfo);
-	jpeg_set_quality(&cinfo,quality,TRUE);
+	m->image = malloc(sizeof(rsn_line)*info->height);
+	for(int y = 0; y < info->height; y++)
+		m->image[y] = (rsn_line)p + y*stride; // Read-only: the library never writes its input
+	return m;
+}
 
-	jpeg_start_compress(&cinfo,TRUE);
+/* P5 and P6 for gray and RGB, PAM for anything with alpha */
+image_map create_pnm_file(rsn_info info, const char* filename) {
+	static const char* tupltypes[] = {"GRAYSCALE","GRAYSCALE_ALPHA","RGB","RGB_ALPHA"};
+	char header[128];
+	int length;
+	if(info.channels == 1 || info.channels == 3)
+		length = snprintf(header,sizeof(header),"P%d\n%d %d\n255\n",info.channels == 1 ? 5 : 6,info.width_s,info.height_s);
+	else
+		length = snprintf(header,sizeof(header),"P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+		                  info.width_s,info.height_s,info.channels,tupltypes[info.channels-1]);
+
+	int fd = open(filename,O_RDWR|O_CREAT|O_TRUNC,0666);
+	if(fd < 0) abort_("[create_pnm_file] File %s could not be opened for writing",filename);
+	size_t stride = (size_t)info.width_s*info.channels;
+	image_map m = calloc(1,sizeof(struct image_map));
+	m->length = length + stride*info.height_s;
+	if(ftruncate(fd,m->length)) abort_("[create_pnm_file] File %s could not be sized",filename);
+	m->map = mmap(NULL,m->length,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	close(fd);
+	if(m->map == MAP_FAILED) abort_("[create_pnm_file] File %s could not be mapped",filename);
+
+	memcpy(m->map,header,length);
+	m->image = malloc(sizeof(rsn_line)*info.height_s);
+	for(int y = 0; y < info.height_s; y++)
+		m->image[y] = (rsn_line)m->map + length + y*stride;
+	return m;
+}
 
-	for(int y = 0; cinfo.next_scanline < info.height_s; y++)
-		jpeg_write_scanlines(&cinfo,&image[y],1);
+void unmap_image(image_map m) {
+	munmap(m->map,m->length);
+	free(m->image);
+	free(m);
+}
 
-	jpeg_finish_compress(&cinfo);
-	jpeg_destroy_compress(&cinfo);
-	fclose(f);
+void write_pnm_file(rsn_info info, const char* filename, rsn_image image) {
+	image_map m = create_pnm_file(info,filename);
+	for(int y = 0; y < info.height_s; y++)
+		memcpy(m->image[y],image[y],sizeof(rsn_pel)*info.width_s*info.channels);
+	unmap_image(m);
 }
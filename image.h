@@ -15,11 +15,49 @@
 #define RSN_IMGTYPE_NONE -1
 #define RSN_IMGTYPE_PNG   0
 #define RSN_IMGTYPE_JPEG  1
+#define RSN_IMGTYPE_PNM   2
+
+/* PNG compression. level and strategy are zlib's, filters a mask of libpng's PNG_FILTER_* values; -1, 0 and -1 leave
+ * each to libpng. More than one thread selects the parallel writer, which deflates strips of rows independently. */
+typedef struct {
+	int level, filters, strategy, threads;
+} png_options;
+#define PNG_OPTIONS_DEFAULT ((png_options){-1,0,-1,1})
 
 /* Image I/O */
 rsn_image read_png_file(rsn_infop,const char*);
 rsn_image read_jpeg_file(rsn_infop,const char*);
-void write_png_file(rsn_info,const char*,rsn_image);
+void write_png_file(rsn_info,const char*,rsn_image,png_options);
 void write_jpeg_file(rsn_info,const char*,rsn_image,int);
 
+/* Streaming input: opens the file and fills in info, leaving the rows to be pulled by the library through
+ * read_image_row (an rsn_reader). Returns NULL for files that can't be read a row at a time (interlaced PNG). */
+typedef struct image_reader* image_reader;
+image_reader open_png_reader(rsn_infop,const char*);
+image_reader open_jpeg_reader(rsn_infop,const char*);
+image_reader open_jpeg_scaled_reader(rsn_infop,const char*,int);
+/* Reads a JPEG at 1/8 scale straight from its DC coefficients. NULL for color spaces other than gray and YCbCr. */
+image_reader open_jpeg_dc_reader(rsn_infop,const char*);
+void read_image_row(void*,int,rsn_line);
+void close_image_reader(image_reader);
+
+/* Streaming output: write_image_row is an rsn_writer, taking rows in order */
+typedef struct image_writer* image_writer;
+image_writer open_png_writer(rsn_info,const char*,png_options);
+image_writer open_jpeg_writer(rsn_info,const char*,int);
+void write_image_row(void*,int,rsn_line);
+void close_image_writer(image_writer);
+
+/* Memory-mapped binary PGM, PPM and PAM at 8 bits per sample: image rows point straight into the file.
+ * map_pnm_file maps an input read-only; create_pnm_file sizes and maps a width_s x height_s output. */
+typedef struct image_map {
+	rsn_image image;
+	void* map;
+	size_t length;
+}* image_map;
+image_map map_pnm_file(rsn_infop,const char*);
+image_map create_pnm_file(rsn_info,const char*);
+void unmap_image(image_map);
+void write_pnm_file(rsn_info,const char*,rsn_image);
+
 #endif
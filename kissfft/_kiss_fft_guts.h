@@ -16,6 +16,8 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
    defines kiss_fft_scalar as either short or a float type
    and defines
    typedef struct { kiss_fft_scalar r; kiss_fft_scalar i; }kiss_fft_cpx; */
+#ifndef KISS_FFT_GUTS_H
+#define KISS_FFT_GUTS_H
 #include "kiss_fft.h"
 #include <limits.h>
 
@@ -25,11 +27,30 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  4*4*4*2
  */
 
+/* With lanes, a twiddle is the same for every lane, so it is kept as one scalar pair and broadcast where used */
+#ifdef KISS_FFT_LANES
+typedef struct {
+    kiss_fft_lane r;
+    kiss_fft_lane i;
+}kiss_fft_twiddle;
+#else
+typedef kiss_fft_cpx kiss_fft_twiddle;
+#endif
+
+/* Lengths whose generic butterflies would cost more go through a chirp-z (Bluestein) convolution instead.
+   That needs the scalar arithmetic of a float build, so fixed point and USE_SIMD keep the butterflies. */
+#if !defined(FIXED_POINT) && !defined(USE_SIMD)
+#  define KISS_FFT_CHIRPZ
+#endif
+
 struct kiss_fft_state{
     int nfft;
     int inverse;
     int factors[2*MAXFACTORS];
-    kiss_fft_cpx twiddles[1];
+    kiss_fft_cfg chirpz; /* the smooth length transform doing the convolution, NULL for butterflies */
+    int maxgeneric; /* largest radix left to kf_bfly_generic, 0 if none */
+    kiss_fft_cpx * scratch; /* allocated with the configuration, see kiss_fft_alloc */
+    kiss_fft_twiddle twiddles[1]; /* or nfft chirp factors followed by the filter's spectrum */
 };
 
 /*
@@ -132,11 +153,22 @@ struct kiss_fft_state{
 #  define KISS_FFT_COS(phase) _mm_set1_ps( cos(phase) )
 #  define KISS_FFT_SIN(phase) _mm_set1_ps( sin(phase) )
 #  define HALF_OF(x) ((x)*_mm_set1_ps(.5))
+#elif defined(KISS_FFT_LANES)
+#  define KISS_FFT_COS(phase) (kiss_fft_lane) cos(phase)
+#  define KISS_FFT_SIN(phase) (kiss_fft_lane) sin(phase)
+#  define HALF_OF(x) ((x)*(kiss_fft_lane).5)
+#  define KISS_FFT_SPLAT(x) ( (kiss_fft_scalar){0} + (kiss_fft_lane)(x) )
+#  define KISS_FFT_LANE0(x) ((x)[0])
 #else
 #  define KISS_FFT_COS(phase) (kiss_fft_scalar) cos(phase)
 #  define KISS_FFT_SIN(phase) (kiss_fft_scalar) sin(phase)
 #  define HALF_OF(x) ((x)*.5)
 #endif
+#ifndef KISS_FFT_SPLAT
+/* a scalar in every lane, and back */
+#  define KISS_FFT_SPLAT(x) (kiss_fft_scalar)(x)
+#  define KISS_FFT_LANE0(x) (x)
+#endif
 
 #define  kf_cexp(x,phase) \
 	do{ \
@@ -149,16 +181,4 @@ struct kiss_fft_state{
 #define pcpx(c)\
     fprintf(stderr,"%g + %gi\n",(double)((c)->r),(double)((c)->i) )
 
-
-#ifdef KISS_FFT_USE_ALLOCA
-// define this to allow use of alloca instead of malloc for temporary buffers
-// Temporary buffers are used in two case: 
-// 1. FFT sizes that have "bad" factors. i.e. not 2,3 and 5
-// 2. "in-place" FFTs.  Notice the quotes, since kissfft does not really do an in-place transform.
-#include <alloca.h>
-#define  KISS_FFT_TMP_ALLOC(nbytes) alloca(nbytes)
-#define  KISS_FFT_TMP_FREE(ptr) 
-#else
-#define  KISS_FFT_TMP_ALLOC(nbytes) KISS_FFT_MALLOC(nbytes)
-#define  KISS_FFT_TMP_FREE(ptr) KISS_FFT_FREE(ptr)
 #endif
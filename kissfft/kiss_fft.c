@@ -26,7 +26,7 @@ static void kf_bfly2(
         )
 {
     kiss_fft_cpx * Fout2;
-    kiss_fft_cpx * tw1 = st->twiddles;
+    kiss_fft_twiddle * tw1 = st->twiddles;
     kiss_fft_cpx t;
     Fout2 = Fout + m;
     do{
@@ -48,7 +48,7 @@ static void kf_bfly4(
         const size_t m
         )
 {
-    kiss_fft_cpx *tw1,*tw2,*tw3;
+    kiss_fft_twiddle *tw1,*tw2,*tw3;
     kiss_fft_cpx scratch[6];
     size_t k=m;
     const size_t m2=2*m;
@@ -98,9 +98,9 @@ static void kf_bfly3(
 {
      size_t k=m;
      const size_t m2 = 2*m;
-     kiss_fft_cpx *tw1,*tw2;
+     kiss_fft_twiddle *tw1,*tw2;
      kiss_fft_cpx scratch[5];
-     kiss_fft_cpx epi3;
+     kiss_fft_twiddle epi3;
      epi3 = st->twiddles[fstride*m];
 
      tw1=tw2=st->twiddles;
@@ -143,9 +143,9 @@ static void kf_bfly5(
     kiss_fft_cpx *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
     int u;
     kiss_fft_cpx scratch[13];
-    kiss_fft_cpx * twiddles = st->twiddles;
-    kiss_fft_cpx *tw;
-    kiss_fft_cpx ya,yb;
+    kiss_fft_twiddle * twiddles = st->twiddles;
+    kiss_fft_twiddle *tw;
+    kiss_fft_twiddle ya,yb;
     ya = twiddles[fstride*m];
     yb = twiddles[fstride*2*m];
 
@@ -200,16 +200,15 @@ static void kf_bfly_generic(
         const size_t fstride,
         const kiss_fft_cfg st,
         int m,
-        int p
+        int p,
+        kiss_fft_cpx * scratch
         )
 {
     int u,k,q1,q;
-    kiss_fft_cpx * twiddles = st->twiddles;
+    kiss_fft_twiddle * twiddles = st->twiddles;
     kiss_fft_cpx t;
     int Norig = st->nfft;
 
-    kiss_fft_cpx * scratch = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx)*p);
-
     for ( u=0; u<m; ++u ) {
         k=u;
         for ( q1=0 ; q1<p ; ++q1 ) {
@@ -231,7 +230,6 @@ static void kf_bfly_generic(
             k += m;
         }
     }
-    KISS_FFT_TMP_FREE(scratch);
 }
 
 static
@@ -241,7 +239,8 @@ void kf_work(
         const size_t fstride,
         int in_stride,
         int * factors,
-        const kiss_fft_cfg st
+        const kiss_fft_cfg st,
+        kiss_fft_cpx * scratch
         )
 {
     kiss_fft_cpx * Fout_beg=Fout;
@@ -252,14 +251,14 @@ void kf_work(
 #ifdef _OPENMP
     // use openmp extensions at the 
     // top-level (not recursive)
-    if (fstride==1 && p<=5)
+    if (fstride==1 && p<=5 && m>1)
     {
         int k;
 
-        // execute the p different work units in different threads
+        // execute the p different work units in different threads, each with its own generic scratch
 #       pragma omp parallel for
         for (k=0;k<p;++k) 
-            kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st);
+            kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st,scratch+k*st->maxgeneric);
         // all threads have joined by this point
 
         switch (p) {
@@ -267,7 +266,7 @@ void kf_work(
             case 3: kf_bfly3(Fout,fstride,st,m); break; 
             case 4: kf_bfly4(Fout,fstride,st,m); break;
             case 5: kf_bfly5(Fout,fstride,st,m); break; 
-            default: kf_bfly_generic(Fout,fstride,st,m,p); break;
+            default: kf_bfly_generic(Fout,fstride,st,m,p,scratch); break;
         }
         return;
     }
@@ -284,7 +283,7 @@ void kf_work(
             // DFT of size m*p performed by doing
             // p instances of smaller DFTs of size m, 
             // each one takes a decimated version of the input
-            kf_work( Fout , f, fstride*p, in_stride, factors,st);
+            kf_work( Fout , f, fstride*p, in_stride, factors,st,scratch);
             f += fstride*in_stride;
         }while( (Fout += m) != Fout_end );
     }
@@ -297,7 +296,7 @@ void kf_work(
         case 3: kf_bfly3(Fout,fstride,st,m); break; 
         case 4: kf_bfly4(Fout,fstride,st,m); break;
         case 5: kf_bfly5(Fout,fstride,st,m); break; 
-        default: kf_bfly_generic(Fout,fstride,st,m,p); break;
+        default: kf_bfly_generic(Fout,fstride,st,m,p,scratch); break;
     }
 }
 
@@ -329,6 +328,116 @@ void kf_factor(int n,int * facbuf)
     } while (n > 1);
 }
 
+/*  Scratch for kf_bfly_generic: one run of the largest generic radix (which includes the 1 of nfft=1), for each
+    of the work units that kf_work starts in parallel at the top level under OpenMP. maxgeneric is set to it.  */
+static
+size_t kf_generic_scratch(const int * factors,int * maxgeneric)
+{
+    size_t units = 1;
+    const int * f = factors;
+#ifdef _OPENMP
+    if (factors[0] <= 5 && factors[1] > 1)
+        units = factors[0];
+#endif
+    *maxgeneric = 0;
+    do {
+        if ((f[0] > 5 || f[0] < 2) && f[0] > *maxgeneric)
+            *maxgeneric = f[0];
+        f += 2;
+    } while (f[-1] > 1);
+    return units * *maxgeneric;
+}
+
+#ifdef KISS_FFT_CHIRPZ
+/*  The chirp-z length for nfft, or 0 to keep the butterflies. Costs are rough complex multiply-adds per point:
+    p for each radix p above 5 (kf_bfly_generic) and about one for the others, against two transforms of the
+    smallest 2,3,5-smooth length >= 2*nfft-1 and three pointwise products. The smooth stages are weighted up by
+    about a third to match measured timings.  */
+static
+int kf_chirpz_length(int nfft,const int * factors)
+{
+    int nchirp = kiss_fft_next_fast_size(2*nfft-1);
+    int facbuf[2*MAXFACTORS];
+    const int * f = facbuf;
+    double direct=0, chirpz=3;
+
+    do {
+        direct += factors[0] > 5 ? factors[0] : 1;
+        factors += 2;
+    } while (factors[-1] > 1);
+
+    kf_factor(nchirp,facbuf);
+    do {
+        chirpz += 2.7*nchirp/nfft;
+        f += 2;
+    } while (f[-1] > 1);
+
+    return direct > chirpz ? nchirp : 0;
+}
+
+/*  X[k] = w[k] * sum x[n]w[n] conj(w[k-n]) with w[n] = exp(-+i*pi*n^2/nfft), the convolution done circularly at
+    length nchirp. The filter's spectrum is kept pre-scaled by 1/nchirp, and the inverse transform is taken as
+    the conjugate of a forward one so a single sub-configuration serves both.  */
+static
+void kf_chirpz_init(kiss_fft_cfg st,int nchirp,void * mem,size_t subsize)
+{
+    const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+    kiss_fft_twiddle * chirp = st->twiddles;
+    kiss_fft_twiddle * filter = st->twiddles + st->nfft;
+    kiss_fft_cpx * b = st->scratch;
+    int n;
+
+    st->chirpz = kiss_fft_alloc(nchirp,0,mem,&subsize);
+    for (n=0;n<st->nfft;++n) {
+        // n^2 is reduced mod 2*nfft first so that the phase stays exact for long transforms
+        double phase = -pi * (double)((long long)n*n % (2*st->nfft)) / st->nfft;
+        if (st->inverse)
+            phase *= -1;
+        kf_cexp(chirp+n, phase );
+    }
+
+    memset(b,0,sizeof(kiss_fft_cpx)*nchirp);
+    for (n=0;n<st->nfft;++n) {
+        b[n].r = KISS_FFT_SPLAT(chirp[n].r / nchirp);
+        b[n].i = KISS_FFT_SPLAT(-chirp[n].i / nchirp);
+        if (n)
+            b[nchirp-n] = b[n];
+    }
+    kf_work(b+nchirp,b,1,1,st->chirpz->factors,st->chirpz,NULL);
+    for (n=0;n<nchirp;++n) {
+        filter[n].r = KISS_FFT_LANE0(b[nchirp+n].r);
+        filter[n].i = KISS_FFT_LANE0(b[nchirp+n].i);
+    }
+}
+
+static
+void kf_chirpz(const kiss_fft_cfg st,const kiss_fft_cpx * fin,kiss_fft_cpx * fout,int in_stride)
+{
+    const kiss_fft_cfg sub = st->chirpz;
+    const kiss_fft_twiddle * chirp = st->twiddles;
+    const kiss_fft_twiddle * filter = st->twiddles + st->nfft;
+    int n, nchirp = sub->nfft;
+    kiss_fft_cpx * a = st->scratch;
+    kiss_fft_cpx * b = a + nchirp;
+
+    for (n=0;n<st->nfft;++n)
+        C_MUL(a[n],fin[n*in_stride],chirp[n]);
+    memset(a+st->nfft,0,sizeof(kiss_fft_cpx)*(nchirp-st->nfft));
+    kf_work(b,a,1,1,sub->factors,sub,NULL);
+
+    for (n=0;n<nchirp;++n) {
+        C_MUL(a[n],b[n],filter[n]);
+        a[n].i = -a[n].i;
+    }
+    kf_work(b,a,1,1,sub->factors,sub,NULL);
+
+    for (n=0;n<st->nfft;++n) {
+        b[n].i = -b[n].i;
+        C_MUL(fout[n],b[n],chirp[n]);
+    }
+}
+#endif
+
 /*
  *
  * User-callable function to allocate all necessary storage space for the fft.
@@ -339,8 +448,24 @@ void kf_factor(int n,int * facbuf)
 kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
 {
     kiss_fft_cfg st=NULL;
-    size_t memneeded = sizeof(struct kiss_fft_state)
-        + sizeof(kiss_fft_cpx)*(nfft-1); /* twiddle factors*/
+    int factors[2*MAXFACTORS];
+    int nchirp=0;
+    int maxgeneric=0;
+    size_t nscratch;
+    size_t subsize=0;
+    size_t memneeded;
+
+    kf_factor(nfft,factors);
+#ifdef KISS_FFT_CHIRPZ
+    nchirp = kf_chirpz_length(nfft,factors);
+    if (nchirp)
+        kiss_fft_alloc(nchirp,0,NULL,&subsize);
+#endif
+    nscratch = nchirp ? (size_t)2*nchirp : (size_t)nfft + kf_generic_scratch(factors,&maxgeneric);
+    memneeded = sizeof(struct kiss_fft_state)
+        + sizeof(kiss_fft_twiddle)*(nfft+nchirp-1) /* twiddle factors, or chirp and filter*/
+        + sizeof(kiss_fft_cpx)*nscratch
+        + subsize;
 
     if ( lenmem==NULL ) {
         st = ( kiss_fft_cfg)KISS_FFT_MALLOC( memneeded );
@@ -353,7 +478,17 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         int i;
         st->nfft=nfft;
         st->inverse = inverse_fft;
-
+        memcpy(st->factors,factors,sizeof(factors));
+        st->chirpz = NULL;
+        st->maxgeneric = maxgeneric;
+        st->scratch = (kiss_fft_cpx*)(st->twiddles+nfft+nchirp);
+
+#ifdef KISS_FFT_CHIRPZ
+        if (nchirp) {
+            kf_chirpz_init(st,nchirp,st->scratch+nscratch,subsize);
+            return st;
+        }
+#endif
         for (i=0;i<nfft;++i) {
             const double pi=3.141592653589793238462643383279502884197169399375105820974944;
             double phase = -2*pi*i / nfft;
@@ -361,8 +496,6 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
                 phase *= -1;
             kf_cexp(st->twiddles+i, phase );
         }
-
-        kf_factor(nfft,st->factors);
     }
     return st;
 }
@@ -370,15 +503,19 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
 
 void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
 {
+#ifdef KISS_FFT_CHIRPZ
+    if (st->chirpz) {
+        kf_chirpz(st,fin,fout,in_stride);
+        return;
+    }
+#endif
     if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
-        //It just performs an out-of-place FFT into a temp buffer
-        kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
-        kf_work(tmpbuf,fin,1,in_stride, st->factors,st);
-        memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
-        KISS_FFT_TMP_FREE(tmpbuf);
+        //It just performs an out-of-place FFT into the scratch space
+        kf_work(st->scratch,fin,1,in_stride, st->factors,st, st->scratch+st->nfft);
+        memcpy(fout,st->scratch,sizeof(kiss_fft_cpx)*st->nfft);
     }else{
-        kf_work( fout, fin, 1,in_stride, st->factors,st );
+        kf_work( fout, fin, 1,in_stride, st->factors,st, st->scratch+st->nfft );
     }
 }
 
@@ -76,6 +76,9 @@ typedef struct kiss_fft_state* kiss_fft_cfg;
  *  If lenmem is not NULL and ( mem is NULL or *lenmem is not large enough),
  *      then the function returns NULL and places the minimum cfg 
  *      buffer size in *lenmem.
+ *
+ *  The cfg also holds the transform's scratch space, so nothing is allocated
+ *  once it is configured, but a cfg must not be used by two threads at once.
  * */
 
 kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem); 
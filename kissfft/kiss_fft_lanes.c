@@ -0,0 +1,268 @@
+/*
+ Builds kiss_fft.c, kiss_fftr.c and kiss_fftnd.c a second time with kiss_fft_scalar a vector of lanes (see
+ kiss_fft_lanes.h), every external name given a lanes_ prefix so both builds link side by side, then the
+ batched real N-D transforms on top of them.
+*/
+
+#define KISS_FFT_LANES_BUILD
+#include "kiss_fft_lanes.h"
+#undef kiss_fft_scalar
+#define kiss_fft_scalar kiss_fft_lanes
+
+#define kf_work                  lanes_kf_work
+#define kf_factor                lanes_kf_factor
+#define kiss_fft_alloc           lanes_kiss_fft_alloc
+#define kiss_fft_stride          lanes_kiss_fft_stride
+#define kiss_fft                 lanes_kiss_fft
+#define kiss_fft_cleanup         lanes_kiss_fft_cleanup
+#define kiss_fft_next_fast_size  lanes_kiss_fft_next_fast_size
+#define kiss_fftr_alloc          lanes_kiss_fftr_alloc
+#define kiss_fftr                lanes_kiss_fftr
+#define kiss_fftri               lanes_kiss_fftri
+#define kiss_fftnd_alloc         lanes_kiss_fftnd_alloc
+#define kiss_fftnd               lanes_kiss_fftnd
+
+#include "kiss_fft.c"
+#include "kiss_fftr.c"
+#include "kiss_fftnd.c"
+
+#define MIN(x,y) ( ( (x)<(y) )?(x):(y) )
+#define MAX(x,y) ( ( (x)<(y) )?(y):(x) )
+
+/* the caller's kiss_fft_cpx */
+typedef struct {
+    kiss_fft_lane r;
+    kiss_fft_lane i;
+}kiss_fft_lane_cpx;
+
+/* one thread's configs and buffers, as the configs hold their own scratch */
+struct kiss_fftndr_lanes_work
+{
+    kiss_fftr_cfg cfg_r;
+    kiss_fftnd_cfg cfg_nd;
+    kiss_fft_scalar * real; /* dimReal */
+    kiss_fft_cpx * tmp1;    /* MAX(nrbins,dimOther) each */
+    kiss_fft_cpx * tmp2;
+};
+
+struct kiss_fftndr_lanes_state
+{
+    int dimReal;
+    int dimOther;
+    int nthreads;
+    struct kiss_fftndr_lanes_work work[1]; /* nthreads */
+};
+
+static int prod(const int *dims, int ndims)
+{
+    int x=1;
+    while (ndims--)
+        x *= *dims++;
+    return x;
+}
+
+struct kiss_fftndr_lanes_state * kiss_fftndr_lanes_alloc(const int *dims,int ndims,int inverse_fft,int nthreads,void*mem,size_t*lenmem)
+{
+    struct kiss_fftndr_lanes_state * st = NULL;
+    size_t nr=0 , nd=0, ntmp=0, nwork;
+    int dimReal = dims[ndims-1];
+    int dimOther = prod(dims,ndims-1);
+    int nbuf = MAX(dimReal/2+1,dimOther);
+    size_t memneeded;
+    char * ptr;
+    int t;
+
+#ifdef _OPENMP
+    if (nthreads < 1)
+        nthreads = 1;
+#else
+    nthreads = 1;
+#endif
+    (void)kiss_fftr_alloc(dimReal,inverse_fft,NULL,&nr);
+    (void)kiss_fftnd_alloc(dims,ndims-1,inverse_fft,NULL,&nd);
+    ntmp = dimReal*sizeof(kiss_fft_scalar) + 2*nbuf*sizeof(kiss_fft_cpx);
+    nwork = (nr + nd + ntmp + KISS_FFT_LANE_BYTES-1) / KISS_FFT_LANE_BYTES * KISS_FFT_LANE_BYTES;
+
+    memneeded = sizeof(struct kiss_fftndr_lanes_state) + (nthreads-1)*sizeof(struct kiss_fftndr_lanes_work)
+              + nthreads*nwork;
+
+    if (lenmem==NULL) {
+        st = (struct kiss_fftndr_lanes_state *) malloc(memneeded);
+    }else{
+        if (*lenmem >= memneeded)
+            st = (struct kiss_fftndr_lanes_state *)mem;
+        *lenmem = memneeded;
+    }
+    if (st==NULL)
+        return NULL;
+    memset( st , 0 , memneeded);
+
+    st->dimReal = dimReal;
+    st->dimOther = dimOther;
+    st->nthreads = nthreads;
+    ptr = (char*)(st->work + nthreads);
+    for (t=0;t<nthreads;++t) {
+        struct kiss_fftndr_lanes_work * w = st->work + t;
+        size_t n = nr;
+        w->cfg_r = kiss_fftr_alloc( dimReal,inverse_fft,ptr,&n);
+        n = nd;
+        w->cfg_nd = kiss_fftnd_alloc(dims,ndims-1,inverse_fft,ptr+nr,&n);
+        w->tmp1 = (kiss_fft_cpx*)(ptr + nr + nd);
+        w->tmp2 = w->tmp1 + nbuf;
+        w->real = (kiss_fft_scalar*)(w->tmp2 + nbuf);
+        ptr += nwork;
+    }
+
+    return st;
+}
+
+/* Moving n <= KISS_FFT_LANES elements stride apart into or out of one vector, with full vectors as the
+   common case written so that the compiler sees a fixed trip count and can use shuffles */
+static void gather_cpx(kiss_fft_cpx * dst,const kiss_fft_lane_cpx * src,size_t stride,int n)
+{
+    int l;
+    if (n == KISS_FFT_LANES) {
+        for (l=0;l<KISS_FFT_LANES;++l) {
+            dst->r[l] = src[l*stride].r;
+            dst->i[l] = src[l*stride].i;
+        }
+    }else{
+        for (l=0;l<n;++l) {
+            dst->r[l] = src[l*stride].r;
+            dst->i[l] = src[l*stride].i;
+        }
+    }
+}
+
+static void scatter_cpx(kiss_fft_lane_cpx * dst,size_t stride,const kiss_fft_cpx * src,int n)
+{
+    int l;
+    if (n == KISS_FFT_LANES) {
+        for (l=0;l<KISS_FFT_LANES;++l)
+            dst[l*stride] = (kiss_fft_lane_cpx){src->r[l],src->i[l]};
+    }else{
+        for (l=0;l<n;++l)
+            dst[l*stride] = (kiss_fft_lane_cpx){src->r[l],src->i[l]};
+    }
+}
+
+static void gather_real(kiss_fft_scalar * dst,const kiss_fft_lane * src,size_t stride,int n)
+{
+    int l;
+    if (n == KISS_FFT_LANES) {
+        for (l=0;l<KISS_FFT_LANES;++l)
+            (*dst)[l] = src[l*stride];
+    }else{
+        for (l=0;l<n;++l)
+            (*dst)[l] = src[l*stride];
+    }
+}
+
+static void scatter_real(kiss_fft_lane * dst,size_t stride,const kiss_fft_scalar * src,int n)
+{
+    int l;
+    if (n == KISS_FFT_LANES) {
+        for (l=0;l<KISS_FFT_LANES;++l)
+            dst[l*stride] = (*src)[l];
+    }else{
+        for (l=0;l<n;++l)
+            dst[l*stride] = (*src)[l];
+    }
+}
+
+/* The batches of a pass starting at multiples of KISS_FFT_LANES below count, split into nthreads runs; thread t
+   takes [*begin,*end). */
+static void split(int count,int t,int nthreads,int *begin,int *end)
+{
+    int nbatches = (count + KISS_FFT_LANES-1) / KISS_FFT_LANES;
+    *begin = MIN(count, nbatches*t/nthreads * KISS_FFT_LANES);
+    *end = MIN(count, nbatches*(t+1)/nthreads * KISS_FFT_LANES);
+}
+
+/* columns k2..k2+n-1, whose elements are adjacent in each row, in place */
+static void columns(struct kiss_fftndr_lanes_work * w,kiss_fft_lane_cpx *freqdata,int dimOther,int nrbins,int begin,int end)
+{
+    int k1,k2,n;
+    for (k2=begin;k2<end;k2+=KISS_FFT_LANES) {
+        n = MIN(KISS_FFT_LANES,end-k2);
+        for (k1=0;k1<dimOther;++k1)
+            gather_cpx( w->tmp1+k1, freqdata + k1*nrbins+k2, 1, n );
+        kiss_fftnd( w->cfg_nd, w->tmp1, w->tmp2 );
+        for (k1=0;k1<dimOther;++k1)
+            scatter_cpx( freqdata + k1*nrbins+k2, 1, w->tmp2+k1, n );
+    }
+}
+
+/* Lanes past the end of the data keep whatever the last batch left there; they are never scattered back.
+   Rows, then columns, are shared out between the threads, each with its own work set. */
+void kiss_fftndr_lanes_pruned(struct kiss_fftndr_lanes_state * st,const kiss_fft_lane *timedata,kiss_fft_lane_cpx *freqdata,int nbins)
+{
+    int t;
+    int dimReal = st->dimReal;
+    int dimOther = st->dimOther;
+    int nrbins = dimReal/2+1;
+
+    // rows k1..k1+n-1 at once, straight into freqdata
+#ifdef _OPENMP
+#   pragma omp parallel for num_threads(st->nthreads)
+#endif
+    for (t=0;t<st->nthreads;++t) {
+        struct kiss_fftndr_lanes_work * w = st->work + t;
+        int k1,k2,n,begin,end;
+        split(dimOther,t,st->nthreads,&begin,&end);
+        for (k1=begin;k1<end;k1+=KISS_FFT_LANES) {
+            n = MIN(KISS_FFT_LANES,end-k1);
+            for (k2=0;k2<dimReal;++k2)
+                gather_real( w->real+k2, timedata + k1*dimReal+k2, dimReal, n );
+            kiss_fftr( w->cfg_r, w->real, w->tmp1 );
+            for (k2=0;k2<nbins;++k2)
+                scatter_cpx( freqdata + k1*nrbins+k2, nrbins, w->tmp1+k2, n );
+        }
+    }
+
+#ifdef _OPENMP
+#   pragma omp parallel for num_threads(st->nthreads)
+#endif
+    for (t=0;t<st->nthreads;++t) {
+        int begin,end;
+        split(nbins,t,st->nthreads,&begin,&end);
+        columns(st->work + t, freqdata, dimOther, nrbins, begin, end);
+    }
+}
+
+void kiss_fftndri_lanes_pruned(struct kiss_fftndr_lanes_state * st,kiss_fft_lane_cpx *freqdata,kiss_fft_lane *timedata,int nbins,int nrows)
+{
+    int t;
+    int dimReal = st->dimReal;
+    int dimOther = st->dimOther;
+    int nrbins = dimReal/2+1;
+
+    // columns in place, as freqdata is the only full-size buffer
+#ifdef _OPENMP
+#   pragma omp parallel for num_threads(st->nthreads)
+#endif
+    for (t=0;t<st->nthreads;++t) {
+        int begin,end;
+        split(nbins,t,st->nthreads,&begin,&end);
+        columns(st->work + t, freqdata, dimOther, nrbins, begin, end);
+    }
+
+#ifdef _OPENMP
+#   pragma omp parallel for num_threads(st->nthreads)
+#endif
+    for (t=0;t<st->nthreads;++t) {
+        struct kiss_fftndr_lanes_work * w = st->work + t;
+        int k1,k2,n,begin,end;
+        split(nrows,t,st->nthreads,&begin,&end);
+        // the transform of a zero bin is zero, and the gathers below never reach it
+        memset(w->tmp1+nbins,0,sizeof(kiss_fft_cpx)*(nrbins-nbins));
+        for (k1=begin;k1<end;k1+=KISS_FFT_LANES) {
+            n = MIN(KISS_FFT_LANES,end-k1);
+            for (k2=0;k2<nbins;++k2)
+                gather_cpx( w->tmp1+k2, freqdata + k1*nrbins+k2, nrbins, n );
+            kiss_fftri( w->cfg_r, w->tmp1, w->real );
+            for (k2=0;k2<dimReal;++k2)
+                scatter_real( timedata + k1*dimReal+k2, dimReal, w->real+k2, n );
+        }
+    }
+}
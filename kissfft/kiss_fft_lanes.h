@@ -0,0 +1,65 @@
+#ifndef KISS_FFT_LANES_H
+#define KISS_FFT_LANES_H
+
+/*
+ The real N-D transforms with the 1-D passes batched KISS_FFT_LANES at a time: rows, then columns, are gathered
+ into vectors whose lane l belongs to row (or column) k+l, transformed in lockstep as USE_SIMD does four floats
+ with SSE, then scattered back. Vectors are 16 bytes at either precision, which every SIMD target has; wider
+ ones (AVX) measured slower, the extra gather streams costing more than the arithmetic saves. Callers keep
+ plain scalar buffers.
+
+ The 1-D transforms are built a second time from the same sources by kiss_fft_lanes.c, with GCC vector
+ extensions for the arithmetic.
+*/
+
+#ifndef kiss_fft_scalar
+#   define kiss_fft_scalar float
+#endif
+
+#define KISS_FFT_LANE_BYTES 16
+#define KISS_FFT_LANES (KISS_FFT_LANE_BYTES / (int)sizeof(kiss_fft_scalar))
+
+typedef kiss_fft_scalar kiss_fft_lane;
+typedef kiss_fft_lane kiss_fft_lanes __attribute__((vector_size(KISS_FFT_LANE_BYTES),aligned(sizeof(kiss_fft_lane))));
+
+#ifndef KISS_FFT_LANES_BUILD
+#include "kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct kiss_fftndr_lanes_state *kiss_fftndr_lanes_cfg;
+
+kiss_fftndr_lanes_cfg kiss_fftndr_lanes_alloc(const int *dims,int ndims,int inverse_fft,int nthreads,void*mem,size_t*lenmem);
+/*
+ as kiss_fftndr_alloc, but the scratch is a few rows of lanes rather than a copy of the whole input.
+ With OpenMP the row and column passes are split between nthreads threads, each given its own
+ configs and rows of lanes; without it nthreads is taken as 1.
+*/
+
+void kiss_fftndr_lanes_pruned(
+        kiss_fftndr_lanes_cfg cfg,
+        const kiss_fft_scalar *timedata,
+        kiss_fft_cpx *freqdata,
+        int nbins);
+/*
+ as kiss_fftndr_pruned
+*/
+
+void kiss_fftndri_lanes_pruned(
+        kiss_fftndr_lanes_cfg cfg,
+        kiss_fft_cpx *freqdata,
+        kiss_fft_scalar *timedata,
+        int nbins,
+        int nrows);
+/*
+ as kiss_fftndri_pruned, except that the first nbins bins of freqdata are overwritten by the column pass
+*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+
+#endif
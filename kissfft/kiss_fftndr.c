@@ -70,6 +70,11 @@ kiss_fftndr_cfg kiss_fftndr_alloc(const int *dims,int ndims,int inverse_fft,void
 }
 
 void kiss_fftndr(kiss_fftndr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+{
+    kiss_fftndr_pruned(st,timedata,freqdata,st->dimReal/2+1);
+}
+
+void kiss_fftndr_pruned(kiss_fftndr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,int nbins)
 {
     int k1,k2;
     int dimReal = st->dimReal;
@@ -84,11 +89,11 @@ void kiss_fftndr(kiss_fftndr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx
     // take a real chunk of data, fft it and place the output at correct intervals
     for (k1=0;k1<dimOther;++k1) {
         kiss_fftr( st->cfg_r, timedata + k1*dimReal , tmp1 ); // tmp1 now holds nrbins complex points
-        for (k2=0;k2<nrbins;++k2)
+        for (k2=0;k2<nbins;++k2)
            tmp2[ k2*dimOther+k1 ] = tmp1[k2];
     }
 
-    for (k2=0;k2<nrbins;++k2) {
+    for (k2=0;k2<nbins;++k2) {
         kiss_fftnd(st->cfg_nd, tmp2+k2*dimOther, tmp1);  // tmp1 now holds dimOther complex points
         for (k1=0;k1<dimOther;++k1) 
             freqdata[ k1*(nrbins) + k2] = tmp1[k1];
@@ -96,6 +101,11 @@ void kiss_fftndr(kiss_fftndr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx
 }
 
 void kiss_fftndri(kiss_fftndr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
+{
+    kiss_fftndri_pruned(st,freqdata,timedata,st->dimReal/2+1,st->dimOther);
+}
+
+void kiss_fftndri_pruned(kiss_fftndr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata,int nbins,int nrows)
 {
     int k1,k2;
     int dimReal = st->dimReal;
@@ -104,13 +114,16 @@ void kiss_fftndri(kiss_fftndr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scala
     kiss_fft_cpx * tmp1 = (kiss_fft_cpx*)st->tmpbuf; 
     kiss_fft_cpx * tmp2 = tmp1 + MAX(nrbins,dimOther);
 
-    for (k2=0;k2<nrbins;++k2) {
+    for (k2=0;k2<nbins;++k2) {
         for (k1=0;k1<dimOther;++k1) 
             tmp1[k1] = freqdata[ k1*(nrbins) + k2 ];
         kiss_fftnd(st->cfg_nd, tmp1, tmp2+k2*dimOther);
     }
+    // the transform of a zero bin is zero
+    if (nbins < nrbins)
+        memset(tmp2+nbins*dimOther,0,sizeof(kiss_fft_cpx)*(nrbins-nbins)*dimOther);
 
-    for (k1=0;k1<dimOther;++k1) {
+    for (k1=0;k1<nrows;++k1) {
         for (k2=0;k2<nrbins;++k2)
             tmp1[k2] = tmp2[ k2*dimOther+k1 ];
         kiss_fftri( st->cfg_r,tmp1,timedata + k1*dimReal);
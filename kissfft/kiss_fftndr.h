@@ -29,6 +29,16 @@ void kiss_fftndr(
  output freqdata has dims[0] X dims[1] X ... X  dims[ndims-1]/2+1 complex points
 */
 
+void kiss_fftndr_pruned(
+        kiss_fftndr_cfg cfg,
+        const kiss_fft_scalar *timedata,
+        kiss_fft_cpx *freqdata,
+        int nbins);
+/*
+ as kiss_fftndr, but only the first nbins (<= dims[ndims-1]/2+1) bins of the real dimension are transformed
+ along the other dimensions. The remaining bins of freqdata are left untouched.
+*/
+
 void kiss_fftndri(
         kiss_fftndr_cfg cfg,
         const kiss_fft_cpx *freqdata,
@@ -38,6 +48,17 @@ void kiss_fftndri(
 */
 
 
+void kiss_fftndri_pruned(
+        kiss_fftndr_cfg cfg,
+        const kiss_fft_cpx *freqdata,
+        kiss_fft_scalar *timedata,
+        int nbins,
+        int nrows);
+/*
+ as kiss_fftndri, but bins nbins and above of the real dimension are assumed to be zero and are not read,
+ and only the first nrows rows (of dims[0] X ... X dims[ndims-2]) of timedata are produced.
+*/
+
 #define kiss_fftr_free free
 
 #ifdef __cplusplus
@@ -18,7 +18,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 struct kiss_fftr_state{
     kiss_fft_cfg substate;
     kiss_fft_cpx * tmpbuf;
-    kiss_fft_cpx * super_twiddles;
+    kiss_fft_twiddle * super_twiddles;
 #ifdef USE_SIMD    
     void * pad;
 #endif    
@@ -51,7 +51,7 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
 
     st->substate = (kiss_fft_cfg) (st + 1); /*just beyond kiss_fftr_state struct */
     st->tmpbuf = (kiss_fft_cpx *) (((char *) st->substate) + subsize);
-    st->super_twiddles = st->tmpbuf + nfft;
+    st->super_twiddles = (kiss_fft_twiddle *) (st->tmpbuf + nfft);
     kiss_fft_alloc(nfft, inverse_fft, st->substate, &subsize);
 
     for (i = 0; i < nfft/2; ++i) {
@@ -98,6 +98,8 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     freqdata[ncfft].r = tdc.r - tdc.i;
 #ifdef USE_SIMD    
     freqdata[ncfft].i = freqdata[0].i = _mm_set1_ps(0);
+#elif defined(KISS_FFT_LANES)
+    freqdata[ncfft].i = freqdata[0].i = (kiss_fft_scalar){0};
 #else
     freqdata[ncfft].i = freqdata[0].i = 0;
 #endif
@@ -0,0 +1,214 @@
+/*
+ * Resine - Fourier-based image resampling library.
+ * Copyright 2010-2012 command-Q.org. All rights reserved.
+ * This library is distributed under the terms of the GNU Lesser General Public License, Version 2.
+ *
+ * cache.c - On-disk coefficient cache.
+ *	Stores a decomposed spectrum so that later renders at new sizes only need the scale and inverse transform.
+ */
+
+#include "resine.h"
+
+#include "dsp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#define RSN_CACHE_MAGIC   "RSNC"
+#define RSN_CACHE_VERSION 3
+
+/* File layout, host byte order:
+ *	header
+ *	RSN_CACHE_NATIVE:    channels*height*width rsn_frequency
+ *	RSN_CACHE_QUANTIZED: channels pairs of double {dc, step}, then channels*height*width int16_t (DC slots unused)
+ * Planes are stored as the spectrum of a width x height image, i.e. already scaled from the source dimensions,
+ * so a native file can be handed to rsn_scale as-is. alpha and colorspace are the modes the planes were packed
+ * with, which the render has to undo. The header is 32 bytes, which keeps the payload aligned. */
+struct rsn_cache_header {
+	char    magic[4];
+	uint8_t version, precision, size, encoding;
+	int8_t  transform, alpha, colorspace, reserved;
+	int32_t channels, source_width, source_height, width, height;
+};
+
+struct rsn_cache {
+	struct rsn_cache_header header;
+	rsn_spectrum spectrum;
+	void* map;
+	size_t length;
+};
+
+int rsn_cache_write(rsn_info info, rsn_datap data, int encoding, const char* filename) {
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	struct rsn_cache_header header = {
+		RSN_CACHE_MAGIC,RSN_CACHE_VERSION,RSN_PRECISION,sizeof(rsn_frequency),encoding,
+		info.config.transform,info.config.alpha,info.config.colorspace,0,info.channels,info.width,info.height,xlim,ylim
+	};
+	rsn_frequency scale = (xlim*ylim)/(rsn_frequency)(info.width*info.height);
+
+	FILE* f = fopen(filename,"wb");
+	if(!f) return 1;
+	fwrite(&header,sizeof(header),1,f);
+
+	if(encoding == RSN_CACHE_QUANTIZED) {
+		/* DC is kept at full precision; the rest of each plane shares one step sized to its largest magnitude */
+		double planes[info.channels][2];
+		for(int z = 0; z < info.channels; z++) {
+			rsn_spectrum plane = data->freq_image + z*info.height*info.width;
+			rsn_frequency max = 0;
+			for(int y = 0; y < ylim; y++)
+				for(int x = !y; x < xlim; x++)
+					if(rsn_fabs(plane[y*info.width+x]) > max) max = rsn_fabs(plane[y*info.width+x]);
+			planes[z][0] = plane[0] * scale;
+			planes[z][1] = max ? max * scale / INT16_MAX : 1;
+		}
+		fwrite(planes,sizeof(planes),1,f);
+		int16_t row[xlim];
+		for(int z = 0; z < info.channels; z++)
+			for(int y = 0; y < ylim; y++) {
+				rsn_spectrum in = data->freq_image + z*info.height*info.width + y*info.width;
+				for(int x = 0; x < xlim; x++)
+					row[x] = y || x ? lround(in[x] * scale / planes[z][1]) : 0;
+				fwrite(row,sizeof(int16_t),xlim,f);
+			}
+	}
+	else {
+		rsn_frequency row[xlim];
+		for(int z = 0; z < info.channels; z++)
+			for(int y = 0; y < ylim; y++) {
+				rsn_spectrum in = data->freq_image + z*info.height*info.width + y*info.width;
+				for(int x = 0; x < xlim; x++)
+					row[x] = in[x] * scale;
+				fwrite(row,sizeof(rsn_frequency),xlim,f);
+			}
+	}
+	int err = ferror(f);
+	return fclose(f) || err;
+}
+
+int resine_cache(rsn_info info, rsn_image image, int encoding, const char* filename) {
+	info.config.greed |= RSN_GREED_RETAIN;
+	rsn_datap data = rsn_init(info,image);
+	rsn_decompose(info,data);
+	int err = rsn_cache_write(info,data,encoding,filename);
+	rsn_destroy(info,data);
+	return err;
+}
+
+rsn_cache rsn_cache_open(const char* filename) {
+	rsn_cache cache = calloc(1,sizeof(struct rsn_cache));
+	char* bytes = NULL;
+#ifndef _WIN32
+	int fd = open(filename,O_RDONLY);
+	struct stat st;
+	if(fd < 0) goto fail;
+	if(fstat(fd,&st) || (size_t)st.st_size < sizeof(struct rsn_cache_header)) {
+		close(fd);
+		goto fail;
+	}
+	cache->length = st.st_size;
+	cache->map = mmap(NULL,cache->length,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(cache->map == MAP_FAILED) {
+		cache->map = NULL;
+		goto fail;
+	}
+	bytes = cache->map;
+#else
+	FILE* f = fopen(filename,"rb");
+	if(!f) goto fail;
+	fseek(f,0,SEEK_END);
+	cache->length = ftell(f);
+	rewind(f);
+	cache->map = bytes = malloc(cache->length);
+	if(fread(bytes,1,cache->length,f) != cache->length || cache->length < sizeof(struct rsn_cache_header)) {
+		fclose(f);
+		goto fail;
+	}
+	fclose(f);
+#endif
+	memcpy(&cache->header,bytes,sizeof(struct rsn_cache_header));
+
+	struct rsn_cache_header* h = &cache->header;
+	if(memcmp(h->magic,RSN_CACHE_MAGIC,4) || h->version != RSN_CACHE_VERSION) goto fail;
+	if(h->alpha < RSN_ALPHA_KEEP || h->alpha > RSN_ALPHA_PREMULTIPLY) goto fail;
+	if(h->colorspace < RSN_COLORSPACE_SRGB || h->colorspace > RSN_COLORSPACE_YCBCR) goto fail;
+	if(h->channels < 1 || h->channels > 4 || h->width < 1 || h->height < 1 ||
+	   h->width > h->source_width || h->height > h->source_height) goto fail;
+	/* Under 2^62 pels in a plane, so count can't wrap; the payload is divided rather than count multiplied */
+	size_t count = (size_t)h->width*h->height*h->channels;
+	size_t payload = cache->length - sizeof(struct rsn_cache_header);
+	bytes += sizeof(struct rsn_cache_header);
+
+	switch(h->encoding) {
+		case RSN_CACHE_QUANTIZED: {
+			if(payload < sizeof(double)*2*h->channels || (payload - sizeof(double)*2*h->channels)/sizeof(int16_t) < count) goto fail;
+			double* planes = (double*)bytes;
+			int16_t* q = (int16_t*)(planes + 2*h->channels);
+			cache->spectrum = malloc(sizeof(rsn_frequency)*count);
+			for(size_t i = 0, n = (size_t)h->width*h->height; i < count; i++)
+				cache->spectrum[i] = i % n ? q[i] * planes[i/n*2+1] : planes[i/n*2];
+			break;
+		}
+		case RSN_CACHE_NATIVE:
+			/* Mapped as-is when the precision matches, which is the point of the format */
+			if(h->size != sizeof(rsn_frequency) || h->precision != RSN_PRECISION) goto fail;
+			if(payload/sizeof(rsn_frequency) < count) goto fail;
+			cache->spectrum = (rsn_spectrum)bytes;
+			break;
+		default: goto fail;
+	}
+	return cache;
+
+fail:
+	rsn_cache_close(cache);
+	return NULL;
+}
+
+rsn_info rsn_cache_info(rsn_cache cache) {
+	rsn_info info = {.config = rsn_defaults(), .channels = cache->header.channels,
+	                 .width = cache->header.source_width, .height = cache->header.source_height,
+	                 .width_s = cache->header.source_width, .height_s = cache->header.source_height};
+	info.config.transform = cache->header.transform;
+	info.config.alpha = cache->header.alpha;
+	info.config.colorspace = cache->header.colorspace;
+	return info;
+}
+
+/* The cached planes stand in for the spectrum of a width x height image, so rendering is the usual scale and
+   inverse with the mapping as freq_image. Output sizes beyond the cached block are zero-padded as in upscaling.
+   Unpacking follows the alpha mode and colorspace the planes were written in, whatever config says. */
+rsn_image rsn_cache_render(rsn_cache cache, rsn_config config, int width_s, int height_s) {
+	config.greed |= RSN_GREED_RETAIN;
+	config.alpha = cache->header.alpha;
+	config.colorspace = cache->header.colorspace;
+	rsn_info info = {.config = config, .channels = cache->header.channels,
+	                 .width = cache->header.width, .height = cache->header.height, .width_s = width_s, .height_s = height_s};
+	rsn_data data = {.freq_image = cache->spectrum};
+	rsn_scale(info,&data);
+	rsn_recompose(info,&data);
+	rsn_free(config.transform,(void**)&data.freq_image_s);
+	return data.image_s;
+}
+
+void rsn_cache_close(rsn_cache cache) {
+	if(!cache) return;
+	if(cache->spectrum && (char*)cache->spectrum != (char*)cache->map + sizeof(struct rsn_cache_header))
+		free(cache->spectrum);
+#ifndef _WIN32
+	if(cache->map) munmap(cache->map,cache->length);
+#else
+	free(cache->map);
+#endif
+	free(cache);
+}
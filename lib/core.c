@@ -12,7 +12,9 @@
 #include "dsp.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if HAS_KISS
 #	if RSN_PRECISION > DOUBLE
@@ -22,11 +24,14 @@
 #		define kiss_fft_scalar rsn_frequency
 #	endif
 #include <kiss_fftndr.h>
+#include <kiss_fft_lanes.h>
 #endif
 
 /* Methods here should be either public or fully local, so no separate private header */
 void rsn_decompose_native(rsn_info,rsn_datap);
 void rsn_recompose_native(rsn_info,rsn_datap);
+void rsn_decompose_fixed(rsn_info,rsn_datap);
+void rsn_recompose_fixed(rsn_info,rsn_datap);
 #if HAS_KISS
 void rsn_decompose_kiss(rsn_info,rsn_datap);
 void rsn_recompose_kiss(rsn_info,rsn_datap);
@@ -36,16 +41,45 @@ void rsn_decompose_fftw(rsn_info,rsn_datap);
 void rsn_recompose_fftw(rsn_info,rsn_datap);
 void rsn_decompose_fftw_2d(rsn_info,rsn_datap);
 void rsn_recompose_fftw_2d(rsn_info,rsn_datap);
+void rsn_fftw_pass(rsn_info,rsn_spectrum,rsn_spectrum,int,int,bool,int,fftw_r2r_kind);
 #endif
+typedef void (*rsn_visitor)(rsn_info,rsn_line,const int*,void*,int);
+void rsn_pack(rsn_info,rsn_datap);
+void rsn_pack_visit(rsn_info,rsn_line,const int*,void*,int);
+void rsn_scan(rsn_info,rsn_datap,rsn_visitor,void*);
+void rsn_pack_row(rsn_info,rsn_line,const int*,rsn_spectrum,int);
+int rsn_input_channels(rsn_info);
+int rsn_colors(rsn_info);
+bool rsn_premultiplied(rsn_info);
+void rsn_unpack(rsn_info,rsn_datap,rsn_spectrum,rsn_frequency);
+rsn_pel rsn_encode(rsn_frequency,const rsn_pel*);
+void rsn_region(rsn_info,rsn_image,rsn_line*,int*);
+int rsn_pad(int,int,int);
+int rsn_engine(rsn_info);
+double rsn_native_cost(int,int,int);
+void rsn_banded_taps(rsn_info,int*,int*);
+void rsn_resample_operator(rsn_info,rsn_datap);
+struct rsn_operator_pass;
+void rsn_operator_visit(rsn_info,rsn_line,const int*,void*,int);
+void rsn_operator_flush(struct rsn_operator_pass*);
+void rsn_resample_banded(rsn_info,rsn_datap);
+void rsn_banded_visit(rsn_info,rsn_line,const int*,void*,int);
 void rsn_scale_standard(rsn_info,rsn_datap);
+void rsn_scale_windowed(rsn_info,rsn_datap);
 
 // Will replace the function call in a future rev
 #define RSN_DEFAULTS (rsn_config) {\
-.transform = RSN_TRANSFORM_DEFAULT,\
-.scaling   = RSN_SCALING_STANDARD,\
-.verbosity = 0,\
-.threads   = 1,\
-.greed     = RSN_GREED_RETAIN\
+.transform  = RSN_TRANSFORM_DEFAULT,\
+.scaling    = RSN_SCALING_STANDARD,\
+.verbosity  = 0,\
+.threads    = 1,\
+.greed      = RSN_GREED_RETAIN,\
+.padding    = RSN_PADDING_EDGE,\
+.alpha      = RSN_ALPHA_KEEP,\
+.colorspace = RSN_COLORSPACE_SRGB,\
+.engine     = RSN_ENGINE_SPECTRAL,\
+.background = 0,\
+.tolerance  = 1\
 }
 rsn_config rsn_defaults() {
 	return RSN_DEFAULTS;
@@ -58,6 +92,10 @@ rsn_datap rsn_init(rsn_info info, rsn_image img) {
 	data->freq_image = NULL;
 	data->freq_image_s = NULL;
 	data->image_s = NULL;
+	data->read = NULL;
+	data->reader = NULL;
+	data->write = NULL;
+	data->writer = NULL;
 
 	if(info.config.greed & RSN_GREED_PREALLOC) {
 		data->freq_image   = rsn_malloc(info.config,sizeof(rsn_frequency),info.channels*info.height*info.width);
@@ -74,6 +112,7 @@ rsn_datap rsn_init(rsn_info info, rsn_image img) {
 void rsn_decompose(rsn_info info, rsn_datap data) {
 	if(!data->freq_image)
 		data->freq_image = rsn_malloc(info.config,sizeof(rsn_frequency),info.channels*info.height*info.width);
+	rsn_pack(info,data);
 
 	switch (info.config.transform) {
 #if HAS_FFTW
@@ -82,12 +121,13 @@ void rsn_decompose(rsn_info info, rsn_datap data) {
 #if HAS_KISS
 		case RSN_TRANSFORM_KISS:rsn_decompose_kiss(info,data);    break;
 #endif
+		case RSN_TRANSFORM_FIXED:rsn_decompose_fixed(info,data);  break;
 		default:                rsn_decompose_native(info,data);  break;
 	}
 }
 
 void rsn_recompose(rsn_info info, rsn_datap data) {
-	if(!data->image_s)
+	if(!data->image_s && !data->write)
 		data->image_s = rsn_malloc_array(info.config,sizeof(rsn_pel),info.height_s,info.width_s*info.channels);
 
 	switch (info.config.transform) {
@@ -97,131 +137,370 @@ void rsn_recompose(rsn_info info, rsn_datap data) {
 #if HAS_KISS
 		case RSN_TRANSFORM_KISS:rsn_recompose_kiss(info,data);    break;
 #endif
+		case RSN_TRANSFORM_FIXED:rsn_recompose_fixed(info,data);  break;
 		default:                rsn_recompose_native(info,data);  break;
 	}
 
 	if(!(info.config.greed & RSN_GREED_RETAIN)) rsn_free(info.config.transform,(void**)&data->freq_image_s);
 }
 
+/* De-interleaves the input into freq_image, one plane per channel, ready for an in-place forward transform */
+void rsn_pack(rsn_info info, rsn_datap data) {
+	rsn_scan(info,data,rsn_pack_visit,data->freq_image);
+}
+
+void rsn_pack_visit(rsn_info info, rsn_line line, const int* cols, void* planes, int y) {
+	rsn_pack_row(info,line,cols,planes,y);
+}
+
+/* Hands each region row y to visit with the input line it comes from; pel z of its pixel x is line[cols[x]+z].
+   With a row reader the input image never exists: each row is visited as soon as it is read. */
+void rsn_scan(rsn_info info, rsn_datap data, rsn_visitor visit, void* context) {
+	int cols[info.width];
+	if(!data->read) {
+		rsn_line rows[info.height];
+		rsn_region(info,data->image,rows,cols);
+		for(int y = 0; y < info.height; y++)
+			visit(info,rows[y],cols,context,y);
+		return;
+	}
+
+	/* Padding may use an input row several times, or out of order, so region rows are sorted by the input row
+	   they come from and each input row is read once. */
+	int height = info.source.height ? info.source.height : info.height;
+	int width = info.source.width ? info.source.width : info.width;
+	int first[height+1], next[height], order[info.height];
+	memset(first,0,sizeof(first));
+	for(int y = 0; y < info.height; y++)
+		first[rsn_pad(info.source.y+y,height,info.config.padding)+1]++;
+	for(int j = 0; j < height; j++)
+		next[j] = first[j+1] += first[j];
+	for(int y = info.height-1; y >= 0; y--)
+		order[--next[rsn_pad(info.source.y+y,height,info.config.padding)]] = y;
+	for(int x = 0; x < info.width; x++)
+		cols[x] = rsn_pad(info.source.x+x,width,info.config.padding)*rsn_input_channels(info);
+
+	rsn_line line = malloc(sizeof(rsn_pel)*width*rsn_input_channels(info));
+	for(int j = 0; j < height && first[j] < info.height; j++) {
+		if(first[j] == first[j+1]) continue;
+		data->read(data->reader,j,line);
+		for(int i = first[j]; i < first[j+1]; i++)
+			visit(info,line,cols,context,order[i]);
+	}
+	free(line);
+}
+
+/* Scatters one input row into row y of every plane, pel z of pixel x being line[cols[x]+z]. Alpha handling and
+   colorspace conversion ride along, so neither costs a pass over the image of its own. */
+void rsn_pack_row(rsn_info info, rsn_line line, const int* cols, rsn_spectrum planes, int y) {
+	const rsn_frequency* linear = info.config.colorspace == RSN_COLORSPACE_LINEAR ? rsn_srgb_to_linear() : NULL;
+	int colors = rsn_colors(info);
+	for(int z = 0; z < info.channels; z++) {
+		rsn_spectrum plane = planes + z*info.height*info.width + y*info.width;
+		const rsn_frequency* decode = z < colors ? linear : NULL;
+		if(info.config.alpha == RSN_ALPHA_FLATTEN) {
+			rsn_pel bg = info.config.background >> (16-8*z) & 255;
+			rsn_frequency b = decode ? decode[bg] : bg;
+			for(int x = 0; x < info.width; x++) {
+				rsn_frequency a = line[cols[x]+info.channels] / (rsn_frequency)255;
+				plane[x] = (decode ? decode[line[cols[x]+z]] : line[cols[x]+z])*a + b*(1-a);
+			}
+		}
+		else if(rsn_premultiplied(info) && z < colors)
+			for(int x = 0; x < info.width; x++)
+				plane[x] = (decode ? decode[line[cols[x]+z]] : line[cols[x]+z]) * (line[cols[x]+colors] / (rsn_frequency)255);
+		else if(decode)
+			for(int x = 0; x < info.width; x++)
+				plane[x] = decode[line[cols[x]+z]];
+		else
+			for(int x = 0; x < info.width; x++)
+				plane[x] = line[cols[x]+z];
+	}
+	/* The chroma offset only moves DC and is never clamped against, so it is left out */
+	if(info.config.colorspace == RSN_COLORSPACE_YCBCR && colors == 3) {
+		rsn_spectrum r = planes + y*info.width, g = r + info.height*info.width, b = g + info.height*info.width;
+		for(int x = 0; x < info.width; x++) {
+			rsn_frequency R = r[x], G = g[x], B = b[x];
+			r[x] = 0.299*R + 0.587*G + 0.114*B;
+			g[x] = -0.168736*R - 0.331264*G + 0.5*B;
+			b[x] = 0.5*R - 0.418688*G - 0.081312*B;
+		}
+	}
+}
+
+/* Channels carrying color, i.e. all but a trailing alpha */
+int rsn_colors(rsn_info info) {
+	return info.channels - !(info.channels % 2);
+}
+
+/* PREMULTIPLY only applies when there is an alpha to multiply by; odd channel counts are kept as they are */
+bool rsn_premultiplied(rsn_info info) {
+	return info.config.alpha == RSN_ALPHA_PREMULTIPLY && !(info.channels % 2);
+}
+
+/* Pels per input pixel, counting an alpha channel that is not transformed */
+int rsn_input_channels(rsn_info info) {
+	return info.channels + (info.config.alpha == RSN_ALPHA_DROP || info.config.alpha == RSN_ALPHA_FLATTEN);
+}
+
+/* The alpha of whole words is tested at once: every pixel's alpha byte is at the same offsets in each 4-byte word
+   when the pixel size divides 4, which it does for gray+alpha and RGBA. */
+int rsn_opaque(rsn_info info, rsn_image image) {
+	int height = info.source.height ? info.source.height : info.height;
+	int width = info.source.width ? info.source.width : info.width;
+	size_t length = (size_t)width*info.channels, words = 4 % info.channels ? 0 : length/4;
+	uint32_t mask = 0;
+	for(int i = info.channels-1; i < 4; i += info.channels)
+		((rsn_pel*)&mask)[i] = 255;
+	for(int y = 0; y < height; y++) {
+		uint32_t all = mask;
+		for(size_t i = 0; i < words; i++) {
+			uint32_t word;
+			memcpy(&word,image[y]+i*4,4);
+			all &= word;
+		}
+		if(all != mask) return 0;
+		for(size_t i = words*4 + info.channels-1; i < length; i += info.channels)
+			if(image[y][i] != 255) return 0;
+	}
+	return 1;
+}
+
+/* Interleaves the planar inverse output into rows, normalizing and clamping on the way. Each row is handed to the
+   writer as soon as it is complete when there is one, in which case image_s is never touched.
+   Colorspace and premultiplication are undone here in reverse order of rsn_pack_row; the planes are scratch, so
+   YCbCr is converted back in place. Premultiplied pixels whose alpha rounds to 0 come out black. */
+void rsn_unpack(rsn_info info, rsn_datap data, rsn_spectrum planes, rsn_frequency norm) {
+	rsn_line line = data->write ? malloc(sizeof(rsn_pel)*info.width_s*info.channels) : NULL;
+	const rsn_pel* linear = info.config.colorspace == RSN_COLORSPACE_LINEAR ? rsn_linear_to_srgb() : NULL;
+	int colors = rsn_colors(info);
+	bool premultiplied = rsn_premultiplied(info);
+	for(int y = 0; y < info.height_s; y++) {
+		rsn_line out = line ? line : data->image_s[y];
+		if(info.config.colorspace == RSN_COLORSPACE_YCBCR && colors == 3) {
+			rsn_spectrum r = planes + y*info.width_s, g = r + info.height_s*info.width_s, b = g + info.height_s*info.width_s;
+			for(int x = 0; x < info.width_s; x++) {
+				rsn_frequency Y = r[x], Cb = g[x], Cr = b[x];
+				r[x] = Y + 1.402*Cr;
+				g[x] = Y - 0.344136*Cb - 0.714136*Cr;
+				b[x] = Y + 1.772*Cb;
+			}
+		}
+		rsn_spectrum alpha = planes + (info.channels-1)*info.height_s*info.width_s + y*info.width_s;
+		for(int z = 0; z < info.channels; z++) {
+			rsn_spectrum in = planes + z*info.height_s*info.width_s + y*info.width_s;
+			const rsn_pel* encode = z < colors ? linear : NULL;
+			if(premultiplied && z < colors)
+				for(int x = 0; x < info.width_s; x++) {
+					rsn_frequency a = alpha[x] / norm;
+					out[x*info.channels+z] = rsn_encode(a < 0.5 ? 0 : in[x] / norm * 255 / (a > 255 ? 255 : a),encode);
+				}
+			else if(encode)
+				for(int x = 0; x < info.width_s; x++)
+					out[x*info.channels+z] = rsn_encode(in[x] / norm,encode);
+			else
+				for(int x = 0; x < info.width_s; x++) {
+					rsn_frequency s = in[x] / norm;
+					out[x*info.channels+z] = s > 255 ? 255 : s < 0 ? 0 : round(s);
+				}
+		}
+		if(line) data->write(data->writer,y,line);
+	}
+	free(line);
+}
+
+/* Clamps a value to a pel, through the linear light table when there is one */
+rsn_pel rsn_encode(rsn_frequency s, const rsn_pel* linear) {
+	s = s > 255 ? 255 : s < 0 ? 0 : s;
+	return linear ? linear[(int)(s*RSN_LINEAR_STEPS + 0.5)] : round(s);
+}
+
+/* Reads the transformed region out of the input image: pel z of region pixel (y,x) is rows[y][cols[x]+z].
+   Cropping and edge padding happen entirely through these indices, so the input is never copied. */
+void rsn_region(rsn_info info, rsn_image image, rsn_line* rows, int* cols) {
+	int height = info.source.height ? info.source.height : info.height;
+	int width = info.source.width ? info.source.width : info.width;
+	for(int y = 0; y < info.height; y++)
+		rows[y] = image[rsn_pad(info.source.y+y,height,info.config.padding)];
+	for(int x = 0; x < info.width; x++)
+		cols[x] = rsn_pad(info.source.x+x,width,info.config.padding)*rsn_input_channels(info);
+}
+
+/* Maps a coordinate past either end of [0,length) back inside it */
+int rsn_pad(int i, int length, int padding) {
+	if(padding == RSN_PADDING_MIRROR) {
+		i %= 2*length;
+		if(i < 0) i += 2*length;
+		if(i >= length) i = 2*length-1-i;
+	}
+	return i < 0 ? 0 : i >= length ? length-1 : i;
+}
+
 /* Native transform functions (SLOW) */
 void rsn_decompose_native(rsn_info info, rsn_datap data) {
-	rsn_dct_rowcol(info.channels,info.height,info.width,data->image,data->freq_image);
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	double passes[2] = {0,0};
+	rsn_dct_rowcol_pruned(info.channels,info.height,info.width,ylim,xlim,data->freq_image,data->freq_image,passes);
+	if(info.config.verbosity)
+		printf("Forward row pass took %f seconds, column pass %f seconds\n",passes[0],passes[1]);
 }
 
 void rsn_recompose_native(rsn_info info, rsn_datap data) {
-	rsn_idct_rowcol(info.channels,info.height_s,info.width_s,data->freq_image_s,data->image_s);
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	rsn_spectrum f = malloc(sizeof(rsn_frequency)*info.channels*info.height_s*info.width_s);
+	double passes[2] = {0,0};
+	rsn_idct_rowcol_pruned(info.channels,info.height_s,info.width_s,ylim,xlim,data->freq_image_s,f,passes);
+	if(info.config.verbosity)
+		printf("Inverse row pass took %f seconds, column pass %f seconds\n",passes[0],passes[1]);
+	rsn_unpack(info,data,f,1);
+	free(f);
+}
+
+void rsn_decompose_fixed(rsn_info info, rsn_datap data) {
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	double passes[2] = {0,0};
+	rsn_dct_rowcol_fixed(info.channels,info.height,info.width,ylim,xlim,data->freq_image,data->freq_image,passes);
+	if(info.config.verbosity)
+		printf("Forward row pass took %f seconds, column pass %f seconds\n",passes[0],passes[1]);
+}
+
+void rsn_recompose_fixed(rsn_info info, rsn_datap data) {
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	rsn_spectrum f = malloc(sizeof(rsn_frequency)*info.channels*info.height_s*info.width_s);
+	double passes[2] = {0,0};
+	rsn_idct_rowcol_fixed(info.channels,info.height_s,info.width_s,ylim,xlim,data->freq_image_s,f,passes);
+	if(info.config.verbosity)
+		printf("Inverse row pass took %f seconds, column pass %f seconds\n",passes[0],passes[1]);
+	rsn_unpack(info,data,f,1);
+	free(f);
 }
 
 /* KissFFT transform functions */
 #if HAS_KISS
 void rsn_decompose_kiss(rsn_info info, rsn_datap data) {
-	kiss_fftndr_cfg cfg = kiss_fftndr_alloc((int[]){info.height*2,info.width*2},2,false,NULL,NULL);
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	int threads = 1;
+#if RSN_IS_THREADED
+	threads = info.config.threads;
+#endif
+	kiss_fftndr_lanes_cfg cfg = kiss_fftndr_lanes_alloc((int[]){info.height*2,info.width*2},2,false,threads,NULL,NULL);
 	kiss_fft_scalar* mirrored = malloc(sizeof(kiss_fft_scalar)*info.height*2*info.width*2);
 	kiss_fft_cpx* cpxF = malloc(sizeof(kiss_fft_cpx)*(info.width+1)*info.height*2);
-	kiss_fft_cpx* shift_matrix = malloc(sizeof(kiss_fft_cpx)*(info.width+1)*info.height*2);
+	kiss_fft_cpx* shift_matrix = malloc(sizeof(kiss_fft_cpx)*xlim*ylim);
 
 	/* Shift is a simple factorization of
 		e^(-I*PI*n / 2N) * e^(-I*PI*m / 2M)
+	   Only the coefficients retained by scaling are needed.
 	 */
 	kiss_fft_scalar EXP = -M_PI/(2.0*info.width*info.height);
-	for(int y = 0; y < info.height; y++)
-		for(int x = 0; x < info.width; x++)
-			shift_matrix[y*(info.width+1)+x] = (kiss_fft_cpx) {
-				rsn_cos(EXP*(x*info.width+y*info.height)),
-				rsn_sin(EXP*(x*info.width+y*info.height))
+	for(int y = 0; y < ylim; y++)
+		for(int x = 0; x < xlim; x++)
+			shift_matrix[y*xlim+x] = (kiss_fft_cpx) {
+				rsn_cos(EXP*(x*info.height+y*info.width)),
+				rsn_sin(EXP*(x*info.height+y*info.width))
 			};
 
 	for(int z = 0; z < info.channels; z++) {
+		rsn_spectrum plane = data->freq_image + z*info.height*info.width;
 		for(int y = 0; y < info.height; y++) {
 			for(int x = 0; x < info.width; x++) {
-				mirrored[y*info.width*2+x] = data->image[y][x*info.channels+z];
-				mirrored[y*info.width*2+x+info.width] = data->image[y][(info.width-1-x)*info.channels+z];
+				mirrored[y*info.width*2+x] = plane[y*info.width+x];
+				mirrored[y*info.width*2+x+info.width] = plane[y*info.width+info.width-1-x];
 			}
 			memcpy(mirrored + (info.height*2-1-y)*info.width*2,mirrored + y*info.width*2,sizeof(kiss_fft_scalar)*info.width*2);
 		}
 
-		kiss_fftndr(cfg,mirrored,cpxF);
+		kiss_fftndr_lanes_pruned(cfg,mirrored,cpxF,xlim);
 
-		for(int y = 0; y < info.height; y++)
-			for(int x = 0; x < info.width; x++)
+		for(int y = 0; y < ylim; y++)
+			for(int x = 0; x < xlim; x++)
 				data->freq_image[z*info.height*info.width+y*info.width+x] = 
-				cpxF[y*(info.width+1)+x].r * shift_matrix[y*(info.width+1)+x].r -
-				cpxF[y*(info.width+1)+x].i * shift_matrix[y*(info.width+1)+x].i;
+				cpxF[y*(info.width+1)+x].r * shift_matrix[y*xlim+x].r -
+				cpxF[y*(info.width+1)+x].i * shift_matrix[y*xlim+x].i;
 //In terms of C99 complex
-//				creal((cpxF[y*(info.width+1)+x].r + I*cpxF[y*(info.width+1)+x].i) * cexp(I*(EXP*(x*info.width+y*info.height))));
+//				creal((cpxF[y*(info.width+1)+x].r + I*cpxF[y*(info.width+1)+x].i) * cexp(I*(EXP*(x*info.height+y*info.width))));
 
 	}
+	free(shift_matrix);
 	free(cpxF);
 	free(mirrored);
 	free(cfg);
 }
 
 void rsn_recompose_kiss(rsn_info info, rsn_datap data) {
-	kiss_fftndr_cfg cfg = kiss_fftndr_alloc((int[]){info.height_s*2,info.width_s*2},2,true,NULL,NULL);
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	int threads = 1;
+#if RSN_IS_THREADED
+	threads = info.config.threads;
+#endif
+	kiss_fftndr_lanes_cfg cfg = kiss_fftndr_lanes_alloc((int[]){info.height_s*2,info.width_s*2},2,true,threads,NULL,NULL);
 	kiss_fft_cpx* cpxF = malloc(sizeof(kiss_fft_cpx)*(info.width_s+1)*info.height_s*2);
-	kiss_fft_cpx* shift_matrix = malloc(sizeof(kiss_fft_cpx)*(info.width_s+1)*info.height_s*2);
+	kiss_fft_cpx* shift_matrix = malloc(sizeof(kiss_fft_cpx)*ylim*xlim*2);
 	kiss_fft_scalar* mirrored = malloc(sizeof(kiss_fft_scalar)*info.height_s*2*info.width_s*2);
-
-	// pre-zero nyquist
-	for(int y = 0; y < info.height_s*2; y++)
-		cpxF[y*(info.width_s+1)+info.width_s] = (kiss_fft_cpx){0};
-	for(int x = 0; x < info.width_s; x++)
-		cpxF[info.height_s*(info.width_s+1)+x] = (kiss_fft_cpx){0};
+	rsn_spectrum f = malloc(sizeof(rsn_frequency)*info.channels*info.height_s*info.width_s);
 
 	/* Shift:
 		e^(I*PI*n / 2N) * e^(I*PI*m / 2M)
+	   Scaling leaves nothing outside the retained block, so only it and its mirror are ever written to cpxF
+	   (everything else, nyquist included, stays zero) and only its columns need an inverse transform.
 	 */
 	kiss_fft_scalar EXP = M_PI/(2.0*info.width_s*info.height_s);
-	rsn_frequency* coeff = data->freq_image_s; // iterate for infinitesimal speedup
-
-	for(int x = 0; x < info.width_s; x++)
-		shift_matrix[x] = (kiss_fft_cpx) {
-			rsn_cos(EXP*(x*info.width_s)),
-			rsn_sin(EXP*(x*info.width_s))
-		};
-	for(int y = 1; y < info.height_s; y++)
-		for(int x = 0; x < info.width_s; x++) {
-			shift_matrix[y*(info.width_s+1)+x] = (kiss_fft_cpx) {
-				rsn_cos(EXP*(x*info.width_s+y*info.height_s)),
-				rsn_sin(EXP*(x*info.width_s+y*info.height_s))
+	kiss_fft_cpx* lower = shift_matrix + ylim*xlim;
+	for(int y = 0; y < ylim; y++)
+		for(int x = 0; x < xlim; x++) {
+			shift_matrix[y*xlim+x] = (kiss_fft_cpx) {
+				rsn_cos(EXP*(x*info.height_s+y*info.width_s)),
+				rsn_sin(EXP*(x*info.height_s+y*info.width_s))
 			};
-			shift_matrix[(info.height_s*2-y)*(info.width_s+1)+x] = (kiss_fft_cpx) {
-				-rsn_cos(EXP*(x*info.width_s+(info.height_s*2-y)*info.height_s)),
-				-rsn_sin(EXP*(x*info.width_s+(info.height_s*2-y)*info.height_s))
+			lower[y*xlim+x] = (kiss_fft_cpx) {
+				-rsn_cos(EXP*(x*info.height_s+(info.height_s*2-y)*info.width_s)),
+				-rsn_sin(EXP*(x*info.height_s+(info.height_s*2-y)*info.width_s))
 			};
 		}
 
 	for(int z = 0; z < info.channels; z++) {
-		for(int x = 0; x < info.width_s; x++,coeff++)
+		rsn_frequency* coeff = data->freq_image_s + z*info.height_s*info.width_s;
+		/* The previous channel's column pass was done in place */
+		memset(cpxF,0,sizeof(kiss_fft_cpx)*(info.width_s+1)*info.height_s*2);
+		for(int x = 0; x < xlim; x++)
 			cpxF[x] = (kiss_fft_cpx) {
-				*coeff * shift_matrix[x].r,
-				*coeff * shift_matrix[x].i
+				coeff[x] * shift_matrix[x].r,
+				coeff[x] * shift_matrix[x].i
 			};
-		for(int y = 1; y < info.height_s; y++)
-			for(int x = 0; x < info.width_s; x++,coeff++) {
+		for(int y = 1; y < ylim; y++)
+			for(int x = 0; x < xlim; x++) {
 				// Un-shift the upper-left half of the spectrum (DCT portion)
-				kiss_fft_cpx shift = shift_matrix[y*(info.width_s+1)+x];
+				kiss_fft_cpx shift = shift_matrix[y*xlim+x];
 				cpxF[y*(info.width_s+1)+x] = (kiss_fft_cpx) {
-					*coeff * shift.r,
-					*coeff * shift.i
+					coeff[y*info.width_s+x] * shift.r,
+					coeff[y*info.width_s+x] * shift.i
 				};
 				// Re-create the lower-left half. The entire right side is reconstructed by KISS for real transforms.
-				shift =  shift_matrix[(info.height_s*2-y)*(info.width_s+1)+x];
+				shift = lower[y*xlim+x];
 				cpxF[(info.height_s*2-y)*(info.width_s+1)+x] = (kiss_fft_cpx) {
-					*coeff * shift.r,
-					*coeff * shift.i
+					coeff[y*info.width_s+x] * shift.r,
+					coeff[y*info.width_s+x] * shift.i
 				};
 			}
 
-		kiss_fftndri(cfg,cpxF,mirrored);
+		// Rows past height_s only hold the mirror image
+		kiss_fftndri_lanes_pruned(cfg,cpxF,mirrored,xlim,info.height_s);
 
+		rsn_spectrum plane = f + z*info.height_s*info.width_s;
 		for(int y = 0; y < info.height_s; y++)
-			for(int x = 0; x < info.width_s; x++) {
-				mirrored[y*info.width_s*2+x] /= 4*info.width_s*info.height_s;
-				data->image_s[y][x*info.channels+z] = mirrored[y*info.width_s*2+x] > 255 ? 255 : mirrored[y*info.width_s*2+x] < 0 ? 0 : round(mirrored[y*info.width_s*2+x]);
-			}
+			for(int x = 0; x < info.width_s; x++)
+				plane[y*info.width_s+x] = mirrored[y*info.width_s*2+x];
 	}
+	rsn_unpack(info,data,f,4*info.width_s*info.height_s);
+	free(f);
 	free(mirrored);
+	free(shift_matrix);
 	free(cpxF);
 	free(cfg);
 }
@@ -230,12 +509,6 @@ void rsn_recompose_kiss(rsn_info info, rsn_datap data) {
 /* FFTW transform functions */
 #if HAS_FFTW
 void rsn_decompose_fftw(rsn_info info, rsn_datap data) {
-	int z,y,x;
-	for(z = 0; z < info.channels; z++)
-		for(y = 0; y < info.height; y++) 
-			for(x = 0; x < info.width; x++)
-				data->freq_image[z*info.height*info.width+y*info.width+x] = data->image[y][x*info.channels+z];
-
 #if RSN_IS_THREADED 
 	rsn_fftw_plan_with_nthreads(info.config.threads);
 #endif
@@ -245,7 +518,6 @@ void rsn_decompose_fftw(rsn_info info, rsn_datap data) {
 }
 
 void rsn_recompose_fftw(rsn_info info, rsn_datap data) {
-	int z,y,x;
 	rsn_spectrum output = rsn_fftw_malloc(sizeof(rsn_frequency)*info.channels*info.width_s*info.height_s);
 #if RSN_IS_THREADED
 	rsn_fftw_plan_with_nthreads(info.config.threads);
@@ -254,16 +526,30 @@ void rsn_recompose_fftw(rsn_info info, rsn_datap data) {
 	rsn_fftw_execute(ip);
 	rsn_fftw_destroy_plan(ip);
 
-	for(z = 0; z < info.channels; z++)
-		for(y = 0; y < info.height_s; y++)
-			for(x = 0; x < info.width_s; x++)
-				data->image_s[y][x*info.channels+z] = output[z*info.height_s*info.width_s+y*info.width_s+x] > 255 ? 255 :
-				                                      output[z*info.height_s*info.width_s+y*info.width_s+x] < 0 ? 0 :
-				                                      round(output[z*info.height_s*info.width_s+y*info.width_s+x]);
+	rsn_unpack(info,data,output,1);
 	rsn_fftw_free(output);
 }
 
 void rsn_decompose_fftw_2d(rsn_info info, rsn_datap data) {
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+
+	if(ylim < info.height || xlim < info.width) {
+		/* Downscaling: only the retained block is needed, so the second pass is restricted to its lines.
+		   The order is chosen by whichever leaves the larger share of the work to the pruned pass. */
+		double rows_first = info.height*info.width*log2(info.width) + xlim*info.height*log2(info.height);
+		double cols_first = info.width*info.height*log2(info.height) + ylim*info.width*log2(info.width);
+		if(rows_first <= cols_first) {
+			rsn_fftw_pass(info,data->freq_image,data->freq_image,info.height,info.width,false,info.height,FFTW_REDFT10);
+			rsn_fftw_pass(info,data->freq_image,data->freq_image,info.height,info.width,true,xlim,FFTW_REDFT10);
+		}
+		else {
+			rsn_fftw_pass(info,data->freq_image,data->freq_image,info.height,info.width,true,info.width,FFTW_REDFT10);
+			rsn_fftw_pass(info,data->freq_image,data->freq_image,info.height,info.width,false,ylim,FFTW_REDFT10);
+		}
+		return;
+	}
+
 	const int dims[2] = {info.height,info.width};
 	const fftw_r2r_kind kind[2] = {FFTW_REDFT10,FFTW_REDFT10};
 #if RSN_IS_THREADED 
@@ -275,39 +561,80 @@ void rsn_decompose_fftw_2d(rsn_info info, rsn_datap data) {
 	                                         data->freq_image,NULL,1,info.width*info.height,
 	                                         kind,FFTW_ESTIMATE);
 
-	rsn_spectrum fptr = data->freq_image;
-	for(int z = 0; z < info.channels; z++)
-		for(int y = 0; y < info.height; y++)
-			for(int x = 0; x < info.width; x++,fptr++)
-				*fptr = data->image[y][x*info.channels+z];
-
 	rsn_fftw_execute(p);
 	rsn_fftw_destroy_plan(p);
 }
 
-void rsn_recompose_fftw_2d(rsn_info info, rsn_datap data) {
-	const int dims[2] = {info.height_s,info.width_s};
-	const fftw_r2r_kind kind[2] = {FFTW_REDFT01,FFTW_REDFT01};
+/* 1D transform along the rows (or columns) of every plane, restricted to the first `lines` of them */
+void rsn_fftw_pass(rsn_info info, rsn_spectrum in, rsn_spectrum out, int height, int width, bool columns, int lines, fftw_r2r_kind kind) {
+	rsn_fftw_iodim dim = columns ? (rsn_fftw_iodim){height,width,width} : (rsn_fftw_iodim){width,1,1};
+	rsn_fftw_iodim many[2] = {
+		{info.channels,height*width,height*width},
+		columns ? (rsn_fftw_iodim){lines,1,1} : (rsn_fftw_iodim){lines,width,width}
+	};
+	rsn_fftw_plan p;
+	/* The planner is not reentrant, and inverses may run concurrently (see resine_data_multi) */
 #if RSN_IS_THREADED
-	rsn_fftw_plan_with_nthreads(info.config.threads);
+#pragma omp critical(rsn_fftw_planner)
+#endif
+	{
+#if RSN_IS_THREADED
+		rsn_fftw_plan_with_nthreads(info.config.threads);
 #endif
+		p = rsn_fftw_plan_guru_r2r(1,&dim,2,many,in,out,&kind,FFTW_ESTIMATE);
+	}
+	rsn_fftw_execute(p);
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_fftw_planner)
+#endif
+	rsn_fftw_destroy_plan(p);
+}
+
+void rsn_recompose_fftw_2d(rsn_info info, rsn_datap data) {
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
 	rsn_spectrum f = rsn_fftw_malloc(sizeof(rsn_frequency)*info.channels*info.height_s*info.width_s);
 
-	rsn_fftw_plan p = rsn_fftw_plan_many_r2r(2,dims,info.channels,
-	                                         data->freq_image_s,NULL,1,info.width_s*info.height_s,
-	                                         f                 ,NULL,1,info.width_s*info.height_s,
-	                                         kind,FFTW_ESTIMATE);
+	if(ylim < info.height_s || xlim < info.width_s) {
+		/* Upscaling: the spectrum is zero outside the retained block, so the first pass only covers its lines
+		   and leaves the remainder of f at zero for the second. */
+		memset(f,0,sizeof(rsn_frequency)*info.channels*info.height_s*info.width_s);
+		double cols_first = xlim*info.height_s*log2(info.height_s) + info.height_s*info.width_s*log2(info.width_s);
+		double rows_first = ylim*info.width_s*log2(info.width_s) + info.width_s*info.height_s*log2(info.height_s);
+		if(cols_first <= rows_first) {
+			rsn_fftw_pass(info,data->freq_image_s,f,info.height_s,info.width_s,true,xlim,FFTW_REDFT01);
+			rsn_fftw_pass(info,f,f,info.height_s,info.width_s,false,info.height_s,FFTW_REDFT01);
+		}
+		else {
+			rsn_fftw_pass(info,data->freq_image_s,f,info.height_s,info.width_s,false,ylim,FFTW_REDFT01);
+			rsn_fftw_pass(info,f,f,info.height_s,info.width_s,true,info.width_s,FFTW_REDFT01);
+		}
+	}
+	else {
+		const int dims[2] = {info.height_s,info.width_s};
+		const fftw_r2r_kind kind[2] = {FFTW_REDFT01,FFTW_REDFT01};
+		rsn_fftw_plan p;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_fftw_planner)
+#endif
+		{
+#if RSN_IS_THREADED
+			rsn_fftw_plan_with_nthreads(info.config.threads);
+#endif
+			p = rsn_fftw_plan_many_r2r(2,dims,info.channels,
+			                           data->freq_image_s,NULL,1,info.width_s*info.height_s,
+			                           f                 ,NULL,1,info.width_s*info.height_s,
+			                           kind,FFTW_ESTIMATE);
+		}
 
-	rsn_fftw_execute(p);
-	rsn_fftw_destroy_plan(p);
+		rsn_fftw_execute(p);
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_fftw_planner)
+#endif
+		rsn_fftw_destroy_plan(p);
+	}
 
-	rsn_spectrum fptr = f;
-	for(int z = 0; z < info.channels; z++)
-		for(int y = 0; y < info.height_s; y++)
-			for(int x = 0; x < info.width_s; x++, fptr++) {
-				*fptr /= 4*info.width_s*info.height_s;
-				data->image_s[y][x*info.channels+z] = *fptr > 255 ? 255 : *fptr < 0 ? 0 : round(*fptr);
-			}
+	rsn_unpack(info,data,f,4*info.width_s*info.height_s);
 	rsn_fftw_free(f);
 }
 #endif
@@ -318,7 +645,11 @@ void rsn_scale(rsn_info info, rsn_datap data) {
 		data->freq_image_s = rsn_malloc(info.config,sizeof(rsn_frequency),info.channels*info.height_s*info.width_s);
 
 	switch (info.config.scaling) {
-		default: rsn_scale_standard(info,data); break;
+		case RSN_SCALING_LANCZOS:
+		case RSN_SCALING_HANN:
+		case RSN_SCALING_KAISER:
+		case RSN_SCALING_GAUSSIAN: rsn_scale_windowed(info,data); break;
+		default:                   rsn_scale_standard(info,data); break;
 	}
 
 	if(!(info.config.greed & RSN_GREED_RETAIN)) rsn_free(info.config.transform,(void**)&data->freq_image);
@@ -336,6 +667,27 @@ void rsn_scale_standard(rsn_info info, rsn_datap data) {
 				data->freq_image_s[z*info.height_s*info.width_s+y*info.width_s+x] = data->freq_image[z*info.height*info.width+y*info.width+x] * scale;
 }
 
+/* Standard scaling with separable window weights folded into the scale factor one row at a time */
+void rsn_scale_windowed(rsn_info info, rsn_datap data) {
+	rsn_frequency scale = (info.width_s*info.height_s)/(rsn_frequency)(info.width*info.height);
+
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	rsn_spectrum wy = rsn_window(info.config.scaling,ylim);
+	rsn_spectrum wx = rsn_window(info.config.scaling,xlim);
+	rsn_frequency weights[xlim];
+	for(int y = 0; y < ylim; y++) {
+		for(int x = 0; x < xlim; x++)
+			weights[x] = wx[x] * wy[y] * scale;
+		for(int z = 0; z < info.channels; z++) {
+			rsn_spectrum in  = data->freq_image   + z*info.height*info.width     + y*info.width;
+			rsn_spectrum out = data->freq_image_s + z*info.height_s*info.width_s + y*info.width_s;
+			for(int x = 0; x < xlim; x++)
+				out[x] = in[x] * weights[x];
+		}
+	}
+}
+
 rsn_image resine(rsn_info info, rsn_image image) {
 	rsn_datap data = rsn_init(info,image);
 	resine_data(info,data);
@@ -345,7 +697,17 @@ rsn_image resine(rsn_info info, rsn_image image) {
 void resine_data(rsn_info info, rsn_datap data) {
 	stopwatch watch = NULL; // shut up clang
 	if(info.config.verbosity) watch = stopwatch_create();
-	
+
+	int engine = rsn_engine(info);
+	if(engine != RSN_ENGINE_SPECTRAL) {
+		if(engine == RSN_ENGINE_BANDED) rsn_resample_banded(info,data);
+		else rsn_resample_operator(info,data);
+		if(info.config.verbosity) {
+			printf("%s resampling completed in %f seconds\n",engine == RSN_ENGINE_BANDED ? "Banded" : "Operator",elapsed(watch,0));
+			destroy_watch(watch);
+		}
+		return;
+	}
 	rsn_decompose(info,data);
 
 	if(info.config.verbosity) {
@@ -369,6 +731,247 @@ void resine_data(rsn_info info, rsn_datap data) {
 	}
 }
 
+/* Rows are resampled RSN_OPERATOR_BLOCK at a time: horizontally as one product with the width operator, then
+   accumulated into every output row through the height operator's rows for them. Only the output and a block of
+   rows are ever held, in whatever order the rows arrive. */
+#define RSN_OPERATOR_BLOCK 32
+struct rsn_operator_pass {
+	rsn_info info;
+	rsn_spectrum width, height;
+	rsn_spectrum rows, rows_s, weights, out;
+	int count, y[RSN_OPERATOR_BLOCK];
+};
+
+/* Multiply-adds for each path: the two operator products against the forward and inverse transforms, whose
+   n log n butterflies cost about this many multiply-adds apiece (measured on smooth sizes; FFTW runs at roughly
+   twice KISS's speed). The native transforms are counted pass by pass as they run, codelets included. The fixed
+   point transform is never the default, so a caller asking for it gets the spectral path.
+   HYBRID also weighs the bands, which are convolutions of taps per output along each axis plus the building of
+   their weights. How many taps the tolerance takes is only measured once a band of the fewest taps that could
+   possibly do, one input spacing either side, would win; near unity scale that is short enough to. */
+#define RSN_OPERATOR_KISS_COST 5
+#define RSN_OPERATOR_FFTW_COST 2
+#define RSN_OPERATOR_MAX_SIZE (1 << 22)
+int rsn_engine(rsn_info info) {
+	if(info.config.engine != RSN_ENGINE_AUTO && info.config.engine != RSN_ENGINE_HYBRID) return info.config.engine;
+	if(info.config.transform == RSN_TRANSFORM_FIXED) return RSN_ENGINE_SPECTRAL;
+	double size = (double)info.width*info.height, size_s = (double)info.width_s*info.height_s;
+	double best = INFINITY, cost;
+	int engine = RSN_ENGINE_SPECTRAL;
+	int ylim = info.height < info.height_s ? info.height : info.height_s;
+	int xlim = info.width < info.width_s ? info.width : info.width_s;
+	if(info.config.transform == RSN_TRANSFORM_NATIVE)
+		best = rsn_native_cost(info.height,info.width,xlim) + rsn_native_cost(xlim,info.height,ylim) +
+		       rsn_native_cost(ylim,info.width_s,xlim) + rsn_native_cost(info.width_s,info.height_s,ylim);
+	else
+		best = (size*log2(size) + size_s*log2(size_s)) *
+		       (info.config.transform == RSN_TRANSFORM_FFTW ? RSN_OPERATOR_FFTW_COST : RSN_OPERATOR_KISS_COST);
+	if((size_t)info.width*info.width_s + (size_t)info.height*info.height_s <= RSN_OPERATOR_MAX_SIZE &&
+	   (cost = (double)info.height*info.width_s*(info.width + info.height_s)) < best) {
+		best = cost;
+		engine = RSN_ENGINE_OPERATOR;
+	}
+	if(info.config.engine != RSN_ENGINE_HYBRID) return engine;
+
+	double tw = 2*ceil((double)info.width/info.width_s), th = 2*ceil((double)info.height/info.height_s);
+	if((double)info.height*info.width_s*tw + size_s*th >= best) return engine;
+	int taps_w, taps_h;
+	rsn_banded_taps(info,&taps_w,&taps_h);
+	cost = (double)info.height*info.width_s*taps_w + size_s*taps_h +
+	       (double)info.width_s*taps_w*xlim + (double)info.height_s*taps_h*ylim;
+	return cost < best ? RSN_ENGINE_BANDED : engine;
+}
+
+/* lines passes of length n through count coefficients, as rsn_dct_rowcol_pruned and rsn_idct_rowcol_pruned run them */
+double rsn_native_cost(int lines, int n, int count) {
+	const struct rsn_codelet* codelet = rsn_codelet(n,count);
+	return lines * (codelet ? (double)codelet->macs : (double)n*count);
+}
+
+void rsn_resample_operator(rsn_info info, rsn_datap data) {
+	if(!data->image_s && !data->write)
+		data->image_s = rsn_malloc_array(info.config,sizeof(rsn_pel),info.height_s,info.width_s*info.channels);
+
+	struct rsn_operator_pass pass = {
+		.info    = info,
+		.width   = rsn_operator(info.config.scaling,info.width,info.width_s),
+		.height  = rsn_operator(info.config.scaling,info.height,info.height_s),
+		.rows    = malloc(sizeof(rsn_frequency)*info.channels*RSN_OPERATOR_BLOCK*info.width),
+		.rows_s  = malloc(sizeof(rsn_frequency)*info.channels*RSN_OPERATOR_BLOCK*info.width_s),
+		.weights = malloc(sizeof(rsn_frequency)*RSN_OPERATOR_BLOCK*info.height_s),
+		.out     = calloc((size_t)info.channels*info.height_s*info.width_s,sizeof(rsn_frequency))
+	};
+	rsn_scan(info,data,rsn_operator_visit,&pass);
+	if(pass.count) rsn_operator_flush(&pass);
+	rsn_unpack(info,data,pass.out,1);
+
+	free(pass.rows);
+	free(pass.rows_s);
+	free(pass.weights);
+	free(pass.out);
+}
+
+void rsn_operator_visit(rsn_info info, rsn_line line, const int* cols, void* context, int y) {
+	struct rsn_operator_pass* pass = context;
+	/* The block is packed as planes of RSN_OPERATOR_BLOCK rows */
+	info.height = RSN_OPERATOR_BLOCK;
+	rsn_pack_row(info,line,cols,pass->rows,pass->count);
+	pass->y[pass->count++] = y;
+	if(pass->count == RSN_OPERATOR_BLOCK) rsn_operator_flush(pass);
+}
+
+void rsn_operator_flush(struct rsn_operator_pass* pass) {
+	rsn_info info = pass->info;
+	int threads = 1;
+#if RSN_IS_THREADED
+	threads = info.config.threads;
+#endif
+	for(int b = 0; b < pass->count; b++)
+		memcpy(pass->weights + b*info.height_s,pass->height + (size_t)pass->y[b]*info.height_s,sizeof(rsn_frequency)*info.height_s);
+	for(int z = 0; z < info.channels; z++) {
+		rsn_spectrum rows = pass->rows + z*RSN_OPERATOR_BLOCK*info.width;
+		rsn_spectrum rows_s = pass->rows_s + z*RSN_OPERATOR_BLOCK*info.width_s;
+		memset(rows_s,0,sizeof(rsn_frequency)*pass->count*info.width_s);
+		rsn_gemm(pass->count,info.width_s,info.width,rows,info.width,1,pass->width,info.width_s,rows_s,info.width_s,threads);
+		rsn_gemm(info.height_s,info.width_s,pass->count,pass->weights,1,info.height_s,rows_s,info.width_s,
+		         pass->out + (size_t)z*info.height_s*info.width_s,info.width_s,threads);
+	}
+	pass->count = 0;
+}
+
+/* Each input row is reduced horizontally through the width band as it arrives, then added into just the output
+   rows whose height band reaches it. Nothing is held but that row and the output. */
+struct rsn_band_pass {
+	rsn_info row;
+	rsn_band width, height;
+	rsn_spectrum line, line_s, out;
+};
+
+void rsn_resample_banded(rsn_info info, rsn_datap data) {
+	if(!data->image_s && !data->write)
+		data->image_s = rsn_malloc_array(info.config,sizeof(rsn_pel),info.height_s,info.width_s*info.channels);
+
+	int taps_w, taps_h;
+	rsn_banded_taps(info,&taps_w,&taps_h);
+	struct rsn_band_pass pass = {
+		info,
+		rsn_band_create(info.config.scaling,info.width,info.width_s,taps_w),
+		rsn_band_create(info.config.scaling,info.height,info.height_s,taps_h),
+		malloc(sizeof(rsn_frequency)*info.channels*info.width),
+		malloc(sizeof(rsn_frequency)*info.channels*info.width_s),
+		calloc((size_t)info.channels*info.height_s*info.width_s,sizeof(rsn_frequency))
+	};
+	pass.row.height = 1;
+	if(info.config.verbosity)
+		printf("Banded operators: %d x %d taps\n",pass.width->taps,pass.height->taps);
+	rsn_scan(info,data,rsn_banded_visit,&pass);
+	rsn_unpack(info,data,pass.out,1);
+
+	free(pass.line);
+	free(pass.line_s);
+	free(pass.out);
+}
+
+/* The cut operators differ from the whole ones by at most
+   255 * (height error * norm(width) + norm(height) * width error), so each cut gets half the tolerance */
+void rsn_banded_taps(rsn_info info, int* taps_w, int* taps_h) {
+	rsn_frequency budget = info.config.tolerance / (2*255);
+	*taps_w = rsn_band_taps(info.config.scaling,info.width,info.width_s,
+	                        budget/rsn_band_norm(info.config.scaling,info.height,info.height_s));
+	*taps_h = rsn_band_taps(info.config.scaling,info.height,info.height_s,
+	                        budget/rsn_band_norm(info.config.scaling,info.width,info.width_s));
+}
+
+void rsn_banded_visit(rsn_info info, rsn_line line, const int* cols, void* context, int y) {
+	struct rsn_band_pass* pass = context;
+	rsn_band w = pass->width, h = pass->height;
+	rsn_pack_row(pass->row,line,cols,pass->line,0);
+	for(int z = 0; z < info.channels; z++) {
+		rsn_spectrum in = pass->line + z*info.width;
+		rsn_spectrum row = pass->line_s + z*info.width_s;
+		for(int x = 0; x < info.width_s; x++) {
+			const rsn_frequency* restrict taps = w->weights + x*w->taps,* restrict pels = in + w->start[x];
+			rsn_frequency sum = 0;
+			for(int t = 0; t < w->taps; t++)
+				sum += taps[t] * pels[t];
+			row[x] = sum;
+		}
+		for(int v = h->first[y]; v < h->last[y]; v++) {
+			rsn_frequency weight = h->weights[v*h->taps + y - h->start[v]];
+			rsn_frequency* restrict out = pass->out + ((size_t)z*info.height_s + v)*info.width_s;
+			for(int x = 0; x < info.width_s; x++)
+				out[x] += weight * row[x];
+		}
+	}
+}
+
+rsn_image* resine_multi(rsn_info info, rsn_image image, int count, const int* widths, const int* heights) {
+	rsn_image* out = malloc(sizeof(rsn_image)*count);
+	rsn_datap data = rsn_init(info,image);
+	resine_data_multi(info,data,count,widths,heights,out);
+	rsn_destroy(info,data);
+	return out;
+}
+
+/* The forward transform retains the union of every output's block, after which each output only needs
+   its own scale and inverse. Scale buffers are per-thread and reused across the sizes that thread handles. */
+void resine_data_multi(rsn_info info, rsn_datap data, int count, const int* widths, const int* heights, rsn_image* out) {
+	stopwatch watch = NULL;
+	if(info.config.verbosity) watch = stopwatch_create();
+
+	info.width_s = info.height_s = 0;
+	for(int i = 0; i < count; i++) {
+		if(widths[i] > info.width_s) info.width_s = widths[i];
+		if(heights[i] > info.height_s) info.height_s = heights[i];
+	}
+	rsn_decompose(info,data);
+
+	if(info.config.verbosity) {
+		printf("Forward transform completed in %f seconds\n",elapsed(watch,0));
+		watch_add_stop(watch);
+	}
+
+	int threads = 1;
+#if RSN_IS_THREADED
+	threads = info.config.threads < count ? info.config.threads : count;
+#endif
+	rsn_config config = info.config;
+	config.threads = info.config.threads/threads > 1 ? info.config.threads/threads : 1;
+	config.greed |= RSN_GREED_RETAIN;
+	config.verbosity = 0;
+
+#if RSN_IS_THREADED
+#pragma omp parallel num_threads(threads)
+#endif
+	{
+		rsn_spectrum buffer = rsn_malloc(config,sizeof(rsn_frequency),info.channels*info.height_s*info.width_s);
+#if RSN_IS_THREADED
+#pragma omp for schedule(dynamic)
+#endif
+		for(int i = 0; i < count; i++) {
+			rsn_info sized = info;
+			sized.config = config;
+			sized.width_s = widths[i];
+			sized.height_s = heights[i];
+			rsn_data scratch = {.image = data->image, .freq_image = data->freq_image, .freq_image_s = buffer};
+			// The inverse may read past the retained block, which must be zero
+			memset(buffer,0,sizeof(rsn_frequency)*info.channels*heights[i]*widths[i]);
+			rsn_scale(sized,&scratch);
+			rsn_recompose(sized,&scratch);
+			out[i] = scratch.image_s;
+		}
+		rsn_free(config.transform,(void**)&buffer);
+	}
+
+	if(!(info.config.greed & RSN_GREED_RETAIN)) rsn_free(info.config.transform,(void**)&data->freq_image);
+
+	if(info.config.verbosity) {
+		printf("%d scales and inverse transforms completed in %f seconds\n",count,elapsed(watch,1));
+		printf("Total processing took %f seconds\n",elapsed(watch,0));
+		destroy_watch(watch);
+	}
+}
+
 rsn_image rsn_cleanup(rsn_info info, rsn_datap data) {
 #if HAS_FFTW
 #	if RSN_IS_THREADED
@@ -389,3 +992,8 @@ void rsn_destroy(rsn_info info, rsn_datap data) {
 	rsn_free_array(RSN_TRANSFORM_NONE,info.height_s,(void***)&data->image_s);
 	rsn_cleanup(info,data);
 }
+
+void rsn_release() {
+	rsn_window_cleanup();
+	rsn_operator_cleanup();
+}
@@ -10,7 +10,11 @@
 
 #include "fftwapi.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 /* Canonical implementation of the i/DCT with (very) minor optimizations */
 rsn_frequency CC(int a, int b) { return a ? (b ? 1 : RSN_SQRT1_2) : (b ? RSN_SQRT1_2 : 0.5); }
@@ -88,56 +92,640 @@ void rsn_idct(int L, int M, int N, rsn_spectrum F, rsn_image f) {
 }
 
 void rsn_dct_rowcol(int L, int M, int N, rsn_image f, rsn_spectrum F) {
-	rsn_spectrum tmp = malloc(sizeof(rsn_frequency)*M*N);
-	int t_len = N > M ? N : M;
-	rsn_spectrum twiddles = malloc(sizeof(rsn_frequency)*t_len*t_len);
-	for(int t1 = 0; t1 < t_len; t1++)
-		for(int t2 = 0; t2 < t_len; t2++)
-			twiddles[t1*t_len+t2] = rsn_cos(RSN_PI/t_len * (t2+0.5) * t1) * 2;
+	for(int z = 0; z < L; z++)
+		for(int j = 0; j < M; j++)
+			for(int i = 0; i < N; i++)
+				F[z*M*N+j*N+i] = f[j][i*L+z];
+	rsn_dct_rowcol_pruned(L,M,N,M,N,F,F,NULL);
+}
+
+const struct rsn_codelet* rsn_codelet(int n, int count) {
+	for(const struct rsn_codelet* k = rsn_codelets; k->length; k++)
+		if(k->length == n) return k->macs < (long)n*count ? k : NULL;
+	return NULL;
+}
+
+/* Columns and rows of the second pass are taken in square tiles this wide, so that the intermediate columns and the
+ * twiddle rows a tile needs stay in cache between the dot products that reuse them. */
+#define RSN_ROWCOL_TILE 32
+
+/* Only the V x U lowest coefficients are computed, in both passes, unless a codelet computing all of them is cheaper.
+ * The first pass stores its output transposed, so the column pass reads intermediate columns and twiddles
+ * contiguously, as the row pass does, instead of striding a whole row between elements.
+ * Input is planar; each plane is consumed by the first pass before its output is written, so f may be F.
+ * If passes is not NULL, the CPU seconds spent in the row and column passes are added to passes[0] and passes[1]. */
+void rsn_dct_rowcol_pruned(int L, int M, int N, int V, int U, rsn_spectrum f, rsn_spectrum F, double* passes) {
+	const struct rsn_codelet* row_codelet = rsn_codelet(N,U),* col_codelet = rsn_codelet(M,V);
+	rsn_spectrum tmp = malloc(sizeof(rsn_frequency)*U*M);
+	rsn_spectrum line = malloc(sizeof(rsn_frequency)*(N > M ? N : M));
+	rsn_spectrum row_twiddles = row_codelet ? NULL : malloc(sizeof(rsn_frequency)*U*N);
+	rsn_spectrum col_twiddles = col_codelet ? NULL : malloc(sizeof(rsn_frequency)*V*M);
+	if(!row_codelet)
+		for(int u = 0; u < U; u++)
+			for(int i = 0; i < N; i++)
+				row_twiddles[u*N+i] = rsn_cos(RSN_PI/N * (i+0.5) * u) * 2;
+	if(!col_codelet)
+		for(int v = 0; v < V; v++)
+			for(int j = 0; j < M; j++)
+				col_twiddles[v*M+j] = rsn_cos(RSN_PI/M * (j+0.5) * v) * 2;
 
 	for(int z = 0; z < L; z++) {
-		for(int row = 0; row < M; row++)
-			for(int u = 0; u < N; u++) {
-				tmp[row*N+u] = 0.0;
-				for(int i = 0; i < N; i++)
-					tmp[row*N+u] += f[row][i*L+z] * twiddles[u*t_len+i];
+		clock_t start = clock();
+		if(row_codelet)
+			for(int row = 0; row < M; row++) {
+				row_codelet->dct2(f + z*M*N + row*N,line);
+				for(int u = 0; u < U; u++)
+					tmp[u*M+row] = line[u];
 			}
-		for(int col = 0; col < N; col++)
-			for(int v = 0; v < M; v++)
-				for(int j = 0; j < M; j++)
-					F[z*M*N+v*N+col] += tmp[j*N+col] * twiddles[v*t_len+j];
+		else
+			for(int row = 0; row < M; row++)
+				for(int u = 0; u < U; u++) {
+					rsn_frequency s = 0.0;
+					for(int i = 0; i < N; i++)
+						s += f[z*M*N+row*N+i] * row_twiddles[u*N+i];
+					tmp[u*M+row] = s;
+				}
+		clock_t rows = clock();
+		if(col_codelet)
+			for(int col = 0; col < U; col++) {
+				col_codelet->dct2(tmp + col*M,line);
+				for(int v = 0; v < V; v++)
+					F[z*M*N+v*N+col] = line[v];
+			}
+		else
+			for(int cc = 0; cc < U; cc += RSN_ROWCOL_TILE)
+				for(int vv = 0; vv < V; vv += RSN_ROWCOL_TILE)
+					for(int col = cc; col < U && col < cc + RSN_ROWCOL_TILE; col++)
+						for(int v = vv; v < V && v < vv + RSN_ROWCOL_TILE; v++) {
+							rsn_frequency s = 0.0;
+							for(int j = 0; j < M; j++)
+								s += tmp[col*M+j] * col_twiddles[v*M+j];
+							F[z*M*N+v*N+col] = s;
+						}
+		if(passes) {
+			passes[0] += (rows - start) / (double)CLOCKS_PER_SEC;
+			passes[1] += (clock() - rows) / (double)CLOCKS_PER_SEC;
+		}
 	}
 	free(tmp);
-	free(twiddles);
+	free(line);
+	free(row_twiddles);
+	free(col_twiddles);
 }
 
 void rsn_idct_rowcol(int L, int M, int N, rsn_spectrum F, rsn_image f) {
-	rsn_spectrum tmp = malloc(sizeof(rsn_frequency)*M*N);
+	rsn_spectrum planes = malloc(sizeof(rsn_frequency)*L*M*N);
+	rsn_idct_rowcol_pruned(L,M,N,M,N,F,planes,NULL);
+	for(int z = 0; z < L; z++)
+		for(int j = 0; j < M; j++)
+			for(int i = 0; i < N; i++) {
+				rsn_frequency s = planes[z*M*N+j*N+i];
+				f[j][i*L+z] = s > 255 ? 255 : s < 0 ? 0 : round(s);
+			}
+	free(planes);
+}
+
+/* Coefficients outside the lowest V x U block are taken to be zero, so only V rows are transformed in the first pass.
+ * Codelets are used as in rsn_dct_rowcol_pruned, on the retained coefficients padded with zeros, and the first pass's
+ * output is transposed for the column pass as there. Output is planar, normalized but not clamped. */
+void rsn_idct_rowcol_pruned(int L, int M, int N, int V, int U, rsn_spectrum F, rsn_spectrum f, double* passes) {
+	const struct rsn_codelet* row_codelet = rsn_codelet(N,U),* col_codelet = rsn_codelet(M,V);
+	rsn_spectrum tmp = malloc(sizeof(rsn_frequency)*N*V);
+	rsn_spectrum in = malloc(sizeof(rsn_frequency)*(N > M ? N : M));
+	rsn_spectrum line = malloc(sizeof(rsn_frequency)*(N > M ? N : M));
 	rsn_frequency s;
-	int t_len = N > M ? N : M;
-	rsn_spectrum twiddles = malloc(sizeof(rsn_frequency)*t_len*(t_len-1));
-	for(int t1 = 0; t1 < t_len; t1++)
-		for(int t2 = 1; t2 < t_len; t2++)
-			twiddles[t1*(t_len-1)+t2-1] = rsn_cos(RSN_PI/t_len * (t1+0.5) * t2);
+	rsn_spectrum row_twiddles = row_codelet ? NULL : malloc(sizeof(rsn_frequency)*N*U);
+	rsn_spectrum col_twiddles = col_codelet ? NULL : malloc(sizeof(rsn_frequency)*M*V);
+	if(!row_codelet)
+		for(int i = 0; i < N; i++)
+			for(int u = 1; u < U; u++)
+				row_twiddles[i*U+u] = rsn_cos(RSN_PI/N * (i+0.5) * u);
+	if(!col_codelet)
+		for(int j = 0; j < M; j++)
+			for(int v = 1; v < V; v++)
+				col_twiddles[j*V+v] = rsn_cos(RSN_PI/M * (j+0.5) * v);
 
 	for(int z = 0; z < L; z++) {
-		for(int row = 0; row < M; row++)
+		clock_t start = clock();
+		if(row_codelet) {
+			memset(in + U,0,sizeof(rsn_frequency)*(N-U));
+			for(int row = 0; row < V; row++) {
+				memcpy(in,F + z*M*N + row*N,sizeof(rsn_frequency)*U);
+				row_codelet->dct3(in,line);
+				for(int i = 0; i < N; i++)
+					tmp[i*V+row] = line[i];
+			}
+		}
+		else
+			for(int row = 0; row < V; row++)
+				for(int i = 0; i < N; i++) {
+					s = F[z*M*N+row*N+0]/2;
+					for(int u = 1; u < U; u++)
+						s += F[z*M*N+row*N+u] * row_twiddles[i*U+u];
+					tmp[i*V+row] = s;
+				}
+		clock_t rows = clock();
+		if(col_codelet) {
+			memset(in + V,0,sizeof(rsn_frequency)*(M-V));
+			for(int col = 0; col < N; col++) {
+				memcpy(in,tmp + col*V,sizeof(rsn_frequency)*V);
+				col_codelet->dct3(in,line);
+				for(int j = 0; j < M; j++)
+					f[z*M*N+j*N+col] = line[j] / (N*M);
+			}
+		}
+		else
+			for(int cc = 0; cc < N; cc += RSN_ROWCOL_TILE)
+				for(int jj = 0; jj < M; jj += RSN_ROWCOL_TILE)
+					for(int col = cc; col < N && col < cc + RSN_ROWCOL_TILE; col++)
+						for(int j = jj; j < M && j < jj + RSN_ROWCOL_TILE; j++) {
+							s = tmp[col*V+0]/2;
+							for(int v = 1; v < V; v++)
+								s += tmp[col*V+v] * col_twiddles[j*V+v];
+							f[z*M*N+j*N+col] = s / (N*M);
+						}
+		if(passes) {
+			passes[0] += (rows - start) / (double)CLOCKS_PER_SEC;
+			passes[1] += (clock() - rows) / (double)CLOCKS_PER_SEC;
+		}
+	}
+	free(tmp);
+	free(in);
+	free(line);
+	free(row_twiddles);
+	free(col_twiddles);
+}
+
+/* Fixed-point row-column method. See dsp.h for the formats and error bounds. */
+#define RSN_FIXED_SAMPLE_BITS 2
+#define RSN_FIXED_CONST_BITS  13
+#define RSN_FIXED_CHUNK       256
+#define RSN_FIXED_BITS        30
+
+static int32_t fixed_round(rsn_frequency x) { return x < 0 ? x - 0.5 : x + 0.5; }
+
+static int16_t fixed_cos(int n, int i, int k) {
+	return fixed_round(rsn_cos(RSN_PI/n * (i+0.5) * k) * (1 << RSN_FIXED_CONST_BITS));
+}
+
+/* Rounds a plane of exact sums to RSN_FIXED_BITS magnitude bits, returning the power of two taken out */
+static int fixed_narrow(const int64_t* in, int32_t* out, size_t count) {
+	int64_t max = 0;
+	int shift = 0;
+	for(size_t i = 0; i < count; i++)
+		if(llabs(in[i]) > max) max = llabs(in[i]);
+	while(max >> shift >= (int64_t)1 << RSN_FIXED_BITS) shift++;
+	for(size_t i = 0; i < count; i++)
+		out[i] = shift ? (in[i] + ((int64_t)1 << (shift-1))) >> shift : in[i];
+	return shift;
+}
+
+/* As rsn_dct_rowcol_pruned. Samples are clamped to the range of pels, which bounds RSN_FIXED_CHUNK of their
+   products with the cosines to 31 bits. */
+void rsn_dct_rowcol_fixed(int L, int M, int N, int V, int U, rsn_spectrum f, rsn_spectrum F, double* passes) {
+	int16_t* line = malloc(sizeof(int16_t)*N);
+	int16_t* row_twiddles = malloc(sizeof(int16_t)*U*N);
+	int16_t* col_twiddles = malloc(sizeof(int16_t)*V*M);
+	int64_t* sums = malloc(sizeof(int64_t)*U*M);
+	int32_t* tmp = malloc(sizeof(int32_t)*U*M);
+	int limit = (1 << (8 + RSN_FIXED_SAMPLE_BITS)) - 1;
+	for(int u = 0; u < U; u++)
+		for(int i = 0; i < N; i++)
+			row_twiddles[u*N+i] = fixed_cos(N,i,u);
+	for(int v = 0; v < V; v++)
+		for(int j = 0; j < M; j++)
+			col_twiddles[v*M+j] = fixed_cos(M,j,v);
+
+	for(int z = 0; z < L; z++) {
+		clock_t start = clock();
+		for(int row = 0; row < M; row++) {
+			for(int i = 0; i < N; i++) {
+				int32_t x = fixed_round(f[z*M*N+row*N+i] * (1 << RSN_FIXED_SAMPLE_BITS));
+				line[i] = x > limit ? limit : x < -limit ? -limit : x;
+			}
+			for(int u = 0; u < U; u++) {
+				int64_t s = 0;
+				const int16_t* twiddles = row_twiddles + u*N;
+				for(int ii = 0; ii < N; ii += RSN_FIXED_CHUNK) {
+					int end = N - ii < RSN_FIXED_CHUNK ? N : ii + RSN_FIXED_CHUNK;
+					int32_t chunk = 0;
+					for(int i = ii; i < end; i++)
+						chunk += line[i] * twiddles[i];
+					s += chunk;
+				}
+				sums[u*M+row] = s;
+			}
+		}
+		int shift = fixed_narrow(sums,tmp,(size_t)U*M);
+		clock_t rows = clock();
+		/* Both passes' cosines are doubled as in rsn_dct_rowcol_pruned */
+		rsn_frequency scale = ldexp(1,shift + 2 - RSN_FIXED_SAMPLE_BITS - 2*RSN_FIXED_CONST_BITS);
+		for(int col = 0; col < U; col++)
+			for(int v = 0; v < V; v++) {
+				int64_t s = 0;
+				for(int j = 0; j < M; j++)
+					s += (int64_t)tmp[col*M+j] * col_twiddles[v*M+j];
+				F[z*M*N+v*N+col] = s * scale;
+			}
+		if(passes) {
+			passes[0] += (rows - start) / (double)CLOCKS_PER_SEC;
+			passes[1] += (clock() - rows) / (double)CLOCKS_PER_SEC;
+		}
+	}
+	free(line);
+	free(row_twiddles);
+	free(col_twiddles);
+	free(sums);
+	free(tmp);
+}
+
+/* As rsn_idct_rowcol_pruned, the retained coefficients being scaled to RSN_FIXED_BITS per plane */
+void rsn_idct_rowcol_fixed(int L, int M, int N, int V, int U, rsn_spectrum F, rsn_spectrum f, double* passes) {
+	int32_t* coeff = malloc(sizeof(int32_t)*V*U);
+	int16_t* row_twiddles = malloc(sizeof(int16_t)*N*U);
+	int16_t* col_twiddles = malloc(sizeof(int16_t)*M*V);
+	int64_t* sums = malloc(sizeof(int64_t)*N*V);
+	int32_t* tmp = malloc(sizeof(int32_t)*N*V);
+	for(int i = 0; i < N; i++)
+		for(int u = 0; u < U; u++)
+			row_twiddles[i*U+u] = u ? fixed_cos(N,i,u) : 1 << (RSN_FIXED_CONST_BITS-1);
+	for(int j = 0; j < M; j++)
+		for(int v = 0; v < V; v++)
+			col_twiddles[j*V+v] = v ? fixed_cos(M,j,v) : 1 << (RSN_FIXED_CONST_BITS-1);
+
+	for(int z = 0; z < L; z++) {
+		clock_t start = clock();
+		rsn_frequency max = 0;
+		int exponent;
+		for(int v = 0; v < V; v++)
+			for(int u = 0; u < U; u++)
+				if(rsn_fabs(F[z*M*N+v*N+u]) > max) max = rsn_fabs(F[z*M*N+v*N+u]);
+		frexp(max,&exponent);
+		for(int v = 0; v < V; v++)
+			for(int u = 0; u < U; u++)
+				coeff[v*U+u] = fixed_round(F[z*M*N+v*N+u] * ldexp(1,RSN_FIXED_BITS - exponent));
+		for(int row = 0; row < V; row++)
 			for(int i = 0; i < N; i++) {
-				tmp[row*N+i] = F[z*M*N+row*N+0]/2;
-				for(int u = 1; u < N; u++)
-					tmp[row*N+i] += F[z*M*N+row*N+u] * twiddles[i*(t_len-1)+u-1];
+				int64_t s = 0;
+				for(int u = 0; u < U; u++)
+					s += (int64_t)coeff[row*U+u] * row_twiddles[i*U+u];
+				sums[i*V+row] = s;
 			}
+		int shift = fixed_narrow(sums,tmp,(size_t)N*V);
+		clock_t rows = clock();
+		rsn_frequency scale = ldexp(1,shift + exponent - RSN_FIXED_BITS - 2*RSN_FIXED_CONST_BITS) / (N*M);
 		for(int col = 0; col < N; col++)
 			for(int j = 0; j < M; j++) {
-				s = tmp[0*N+col]/2;
-				for(int v = 1; v < M; v++)
-					s += tmp[v*N+col] * twiddles[j*(t_len-1)+v-1];
-				s /= N*M;
-				f[j][col*L+z] = s > 255 ? 255 : s < 0 ? 0 : round(s);
+				int64_t s = 0;
+				for(int v = 0; v < V; v++)
+					s += (int64_t)tmp[col*V+v] * col_twiddles[j*V+v];
+				f[z*M*N+j*N+col] = s * scale;
 			}
+		if(passes) {
+			passes[0] += (rows - start) / (double)CLOCKS_PER_SEC;
+			passes[1] += (clock() - rows) / (double)CLOCKS_PER_SEC;
+		}
 	}
+	free(coeff);
+	free(row_twiddles);
+	free(col_twiddles);
+	free(sums);
 	free(tmp);
-	free(twiddles);
+}
+
+/* Zeroth order modified Bessel function of the first kind, for the Kaiser window */
+static rsn_frequency bessel_i0(rsn_frequency x) {
+	rsn_frequency sum = 1, term = 1, q = x*x/4;
+	for(int k = 1; term > sum*1e-12; k++) {
+		term *= q/(k*k);
+		sum += term;
+	}
+	return sum;
+}
+
+struct window {
+	int type, length;
+	rsn_spectrum weights;
+	struct window* next;
+};
+static struct window* window_cache = NULL;
+
+rsn_spectrum rsn_window(int type, int length) {
+	struct window* w;
+	rsn_spectrum weights = NULL;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_window)
+#endif
+	{
+		for(w = window_cache; w && !weights; w = w->next)
+			if(w->type == type && w->length == length) weights = w->weights;
+
+		if(!weights) {
+			weights = malloc(sizeof(rsn_frequency)*length);
+			for(int k = 0; k < length; k++) {
+				rsn_frequency t = k/(rsn_frequency)length;
+				switch(type) {
+					case RSN_SCALING_LANCZOS:  weights[k] = k ? rsn_sin(RSN_PI*t)/(RSN_PI*t) : 1;                                  break;
+					case RSN_SCALING_HANN:     weights[k] = 0.5 + 0.5*rsn_cos(RSN_PI*t);                                          break;
+					case RSN_SCALING_KAISER:   weights[k] = bessel_i0(RSN_KAISER_BETA*rsn_sqrt(1-t*t))/bessel_i0(RSN_KAISER_BETA); break;
+					case RSN_SCALING_GAUSSIAN: weights[k] = rsn_exp(-t*t/(2*RSN_GAUSSIAN_SIGMA*RSN_GAUSSIAN_SIGMA));               break;
+					default:                   weights[k] = 1;                                                                    break;
+				}
+			}
+			w = malloc(sizeof(struct window));
+			*w = (struct window){type,length,weights,window_cache};
+			window_cache = w;
+		}
+	}
+	return weights;
+}
+
+void rsn_window_cleanup() {
+	while(window_cache) {
+		struct window* w = window_cache;
+		window_cache = w->next;
+		free(w->weights);
+		free(w);
+	}
+}
+
+struct operator {
+	int type, length, length_s;
+	rsn_spectrum weights;
+	struct operator* next;
+};
+static struct operator* operator_cache = NULL;
+
+/* A band's error for every number of taps, and its operator's norm */
+struct band_profile {
+	int type, length, length_s;
+	rsn_frequency norm;
+	rsn_spectrum error;
+	struct band_profile* next;
+};
+static struct band_profile* profile_cache = NULL;
+static struct rsn_band* band_cache = NULL;
+
+/* Element (n,n') is (w[0] + 2*sum w[u]*cos(pi*(n+1/2)*u/N)*cos(pi*(n'+1/2)*u/Ns))/N over the retained band, the
+   forward 2cos, the Ns/N share of the scale and the inverse's halved DC and 1/Ns folded together. The sum is itself
+   a product of the two cosine tables. */
+rsn_spectrum rsn_operator(int type, int length, int length_s) {
+	struct operator* o;
+	rsn_spectrum weights = NULL;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_operator)
+#endif
+	{
+		for(o = operator_cache; o && !weights; o = o->next)
+			if(o->type == type && o->length == length && o->length_s == length_s) weights = o->weights;
+
+		if(!weights) {
+			int lim = length < length_s ? length : length_s;
+			rsn_spectrum w = type == RSN_SCALING_STANDARD ? NULL : rsn_window(type,lim);
+			rsn_spectrum in = malloc(sizeof(rsn_frequency)*lim*length);
+			rsn_spectrum out = malloc(sizeof(rsn_frequency)*lim*length_s);
+			for(int u = 0; u < lim; u++) {
+				for(int n = 0; n < length; n++)
+					in[u*length+n] = 2 * (w ? w[u] : 1) * rsn_cos(RSN_PI/length * (n+0.5) * u) / length;
+				for(int n = 0; n < length_s; n++)
+					out[u*length_s+n] = rsn_cos(RSN_PI/length_s * (n+0.5) * u);
+			}
+			weights = malloc(sizeof(rsn_frequency)*length*length_s);
+			for(int n = 0; n < length*length_s; n++)
+				weights[n] = (w ? w[0] : 1) / length;
+			rsn_gemm(length,length_s,lim-1,in+length,1,length,out+length_s,length_s,weights,length_s,1);
+			free(in);
+			free(out);
+			o = malloc(sizeof(struct operator));
+			*o = (struct operator){type,length,length_s,weights,operator_cache};
+			operator_cache = o;
+		}
+	}
+	return weights;
+}
+
+void rsn_operator_cleanup() {
+	while(operator_cache) {
+		struct operator* o = operator_cache;
+		operator_cache = o->next;
+		free(o->weights);
+		free(o);
+	}
+	while(profile_cache) {
+		struct band_profile* p = profile_cache;
+		profile_cache = p->next;
+		free(p->error);
+		free(p);
+	}
+	while(band_cache) {
+		rsn_band band = band_cache;
+		band_cache = band->next;
+		free(band->start);
+		free(band->first);
+		free(band->last);
+		free(band->weights);
+		free(band);
+	}
+}
+
+/* Bands are summed straight from the interpolant rather than cut out of rsn_operator, whose N x Ns x min(N,Ns)
+   build is the whole cost of a near-unity resize. Every cos(pi*(n+1/2)*u/N) is cos(pi*k/2N) for k = (2n+1)u mod 4N,
+   so one table per length serves all of them. */
+
+static rsn_spectrum quarter_wave(int length) {
+	rsn_spectrum table = malloc(sizeof(rsn_frequency)*4*length);
+	for(int k = 0; k < 4*length; k++)
+		table[k] = rsn_cos(RSN_PI/(2*length) * k);
+	return table;
+}
+
+/* Column m of the operator, as rsn_operator has it, is the inverse transform of coefficients that only need
+   working out once: element (n,m) is the sum over u of column[u] * cos(pi*(n+1/2)*u/N). */
+static void band_column(const rsn_frequency* w, int lim, const rsn_frequency* out, int length, int length_s, int m,
+                        rsn_frequency* column) {
+	column[0] = (w ? w[0] : 1) / length;
+	for(int u = 1, j = 2*m+1; u < lim; u++, j += 2*m+1) {
+		if(j >= 4*length_s) j -= 4*length_s;
+		column[u] = 2 * (w ? w[u] : 1) * out[j] / length;
+	}
+}
+
+static rsn_frequency band_element(const rsn_frequency* column, int lim, const rsn_frequency* in, int length, int n) {
+	rsn_frequency sum = column[0];
+	for(int u = 1, i = 2*n+1; u < lim; u++, i += 2*n+1) {
+		if(i >= 4*length) i -= 4*length;
+		sum += column[u] * in[i];
+	}
+	return sum;
+}
+
+/* Each output's taps are centered on where it falls in the input, shifted inside at the edges */
+static int band_start(int m, int length, int length_s, int taps) {
+	int start = floor((m+0.5)*length/length_s - 0.5 - (taps-1)/2.0 + 0.5);
+	return start < 0 ? 0 : start > length - taps ? length - taps : start;
+}
+
+/* Measures what a band of every width loses on the operator's columns: all of them when that is cheap, otherwise
+   RSN_BAND_SAMPLES spread evenly from edge to edge, which makes error and norm estimates. Running sums of each
+   column's magnitudes give any band's share in one subtraction. */
+#define RSN_BAND_EXACT   (1 << 25)
+#define RSN_BAND_SAMPLES 32
+static struct band_profile* band_profile(int type, int length, int length_s) {
+	struct band_profile* p;
+	for(p = profile_cache; p; p = p->next)
+		if(p->type == type && p->length == length && p->length_s == length_s) return p;
+
+	int lim = length < length_s ? length : length_s;
+	rsn_spectrum w = type == RSN_SCALING_STANDARD ? NULL : rsn_window(type,lim);
+	rsn_spectrum in = quarter_wave(length), out = quarter_wave(length_s);
+	bool exact = (double)length*length_s*lim <= RSN_BAND_EXACT;
+	int columns = exact || length_s < RSN_BAND_SAMPLES ? length_s : RSN_BAND_SAMPLES;
+	rsn_frequency sums[length+1];
+	rsn_spectrum column = malloc(sizeof(rsn_frequency)*lim);
+
+	p = malloc(sizeof(struct band_profile));
+	*p = (struct band_profile){type,length,length_s,0,calloc(length+1,sizeof(rsn_frequency)),profile_cache};
+	for(int c = 0; c < columns; c++) {
+		int m = columns == length_s ? c : c*(length_s-1)/(columns-1);
+		band_column(w,lim,out,length,length_s,m,column);
+		sums[0] = 0;
+		for(int n = 0; n < length; n++)
+			sums[n+1] = sums[n] + rsn_fabs(band_element(column,lim,in,length,n));
+		if(sums[length] > p->norm) p->norm = sums[length];
+		for(int taps = 1; taps < length; taps++) {
+			int start = band_start(m,length,length_s,taps);
+			rsn_frequency lost = sums[length] - (sums[start+taps] - sums[start]);
+			if(lost > p->error[taps]) p->error[taps] = lost;
+		}
+	}
+	free(in);
+	free(out);
+	free(column);
+	profile_cache = p;
+	return p;
+}
+
+rsn_frequency rsn_band_norm(int type, int length, int length_s) {
+	rsn_frequency norm;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_operator)
+#endif
+	norm = band_profile(type,length,length_s)->norm;
+	return norm;
+}
+
+int rsn_band_taps(int type, int length, int length_s, rsn_frequency error) {
+	int taps = 1;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_operator)
+#endif
+	{
+		struct band_profile* p = band_profile(type,length,length_s);
+		while(taps < length && p->error[taps] > error) taps++;
+	}
+	return taps;
+}
+
+rsn_band rsn_band_create(int type, int length, int length_s, int taps) {
+	rsn_band band;
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_operator)
+#endif
+	{
+		for(band = band_cache; band; band = band->next)
+			if(band->type == type && band->length == length && band->length_s == length_s && band->taps == taps) break;
+
+		if(!band) {
+			int lim = length < length_s ? length : length_s;
+			rsn_spectrum w = type == RSN_SCALING_STANDARD ? NULL : rsn_window(type,lim);
+			rsn_spectrum in = quarter_wave(length), out = quarter_wave(length_s);
+			band = malloc(sizeof(struct rsn_band));
+			*band = (struct rsn_band){type,length,length_s,taps,malloc(sizeof(int)*length_s),malloc(sizeof(int)*length),
+			                          malloc(sizeof(int)*length),malloc(sizeof(rsn_frequency)*length_s*taps),
+			                          band_profile(type,length,length_s)->error[taps],band_cache};
+			rsn_spectrum column = malloc(sizeof(rsn_frequency)*lim);
+			for(int m = 0; m < length_s; m++) {
+				band->start[m] = band_start(m,length,length_s,taps);
+				band_column(w,lim,out,length,length_s,m,column);
+				for(int t = 0; t < taps; t++)
+					band->weights[m*taps+t] = band_element(column,lim,in,length,band->start[m]+t);
+			}
+			free(column);
+			/* Starts never decrease, so the outputs reaching each input are a run that only moves forward */
+			for(int n = 0, first = 0, last = 0; n < length; n++) {
+				while(first < length_s && band->start[first] + taps <= n) first++;
+				while(last < length_s && band->start[last] <= n) last++;
+				band->first[n] = first;
+				band->last[n] = last;
+			}
+			free(in);
+			free(out);
+			band_cache = band;
+		}
+	}
+	return band;
+}
+
+/* Blocked so that a KC x NC panel of B stays in cache while each thread's rows of A stream past it. The innermost
+   loop runs along contiguous rows of B and C for the vectorizer. */
+#define RSN_GEMM_KC 128
+#define RSN_GEMM_NC 256
+void rsn_gemm(int m, int n, int k, const rsn_frequency* A, int ai, int ap, const rsn_frequency* B, int ldb,
+              rsn_frequency* C, int ldc, int threads) {
+	if(threads > m) threads = m;
+#if RSN_IS_THREADED
+#pragma omp parallel for num_threads(threads)
+#endif
+	for(int t = 0; t < threads; t++)
+		for(int pp = 0; pp < k; pp += RSN_GEMM_KC)
+			for(int jj = 0; jj < n; jj += RSN_GEMM_NC) {
+				int kc = k - pp < RSN_GEMM_KC ? k - pp : RSN_GEMM_KC;
+				int nc = n - jj < RSN_GEMM_NC ? n - jj : RSN_GEMM_NC;
+				for(int i = m*t/threads; i < m*(t+1)/threads; i++) {
+					rsn_frequency* restrict c = C + (size_t)i*ldc + jj;
+					for(int p = pp; p < pp + kc; p++) {
+						const rsn_frequency a = A[(size_t)i*ai + (size_t)p*ap];
+						const rsn_frequency* restrict b = B + (size_t)p*ldb + jj;
+						for(int j = 0; j < nc; j++)
+							c[j] += a * b[j];
+					}
+				}
+			}
+}
+
+static rsn_frequency srgb_to_linear[256];
+static rsn_pel linear_to_srgb[255*RSN_LINEAR_STEPS+1];
+static bool colorspace_tables = false;
+
+/* The inverse table is fine enough that looking up the nearest entry is off by at most a tenth of a level */
+static void rsn_colorspace_init() {
+#if RSN_IS_THREADED
+#pragma omp critical(rsn_colorspace)
+#endif
+	if(!colorspace_tables) {
+		for(int i = 0; i < 256; i++) {
+			rsn_frequency c = i/RSN_SUFFIX_CONSTANT(255.0);
+			srgb_to_linear[i] = 255 * (c <= RSN_SUFFIX_CONSTANT(0.04045) ? c/RSN_SUFFIX_CONSTANT(12.92) :
+			                           rsn_pow((c+RSN_SUFFIX_CONSTANT(0.055))/RSN_SUFFIX_CONSTANT(1.055),RSN_SUFFIX_CONSTANT(2.4)));
+		}
+		for(int i = 0; i <= 255*RSN_LINEAR_STEPS; i++) {
+			rsn_frequency l = i/(RSN_SUFFIX_CONSTANT(255.0)*RSN_LINEAR_STEPS);
+			rsn_frequency c = l <= RSN_SUFFIX_CONSTANT(0.0031308) ? l*RSN_SUFFIX_CONSTANT(12.92) :
+			                  RSN_SUFFIX_CONSTANT(1.055)*rsn_pow(l,1/RSN_SUFFIX_CONSTANT(2.4)) - RSN_SUFFIX_CONSTANT(0.055);
+			linear_to_srgb[i] = c*255 + RSN_SUFFIX_CONSTANT(0.5);
+		}
+		colorspace_tables = true;
+	}
+}
+
+const rsn_frequency* rsn_srgb_to_linear() {
+	rsn_colorspace_init();
+	return srgb_to_linear;
+}
+
+const rsn_pel* rsn_linear_to_srgb() {
+	rsn_colorspace_init();
+	return linear_to_srgb;
 }
 
 rsn_image spectrogram(int L, int M, int N, rsn_spectrum F) {
@@ -26,6 +26,7 @@
 #define rsn_log      RSN_SUFFIX_PRECISION(log,)
 #define rsn_pow      RSN_SUFFIX_PRECISION(pow,)
 #define rsn_copysign RSN_SUFFIX_PRECISION(copysign,)
+#define rsn_exp      RSN_SUFFIX_PRECISION(exp,)
 #define RSN_PI       RSN_SUFFIX_CONSTANT(M_PI)
 #define RSN_SQRT1_2  RSN_SUFFIX_CONSTANT(M_SQRT1_2)
 #define RSN_E        RSN_SUFFIX_CONSTANT(M_E)
@@ -37,8 +38,73 @@ rsn_frequency CC(int,int);
 void rsn_dct(int,int,int,rsn_image,rsn_spectrum);
 void rsn_idct(int,int,int,rsn_spectrum,rsn_image);
 void rsn_dct_direct(int,int,int,rsn_image,rsn_spectrum);
-/* Row Column method */
+/* Row Column method. The pruned forms optionally add the time spent in each pass to a pair of seconds. */
 void rsn_dct_rowcol(int,int,int,rsn_image,rsn_spectrum);
+void rsn_dct_rowcol_pruned(int,int,int,int,int,rsn_spectrum,rsn_spectrum,double*);
 void rsn_idct_rowcol(int,int,int,rsn_spectrum,rsn_image);
+void rsn_idct_rowcol_pruned(int,int,int,int,int,rsn_spectrum,rsn_spectrum,double*);
+/* The same in fixed point, for 8-bit sources (RSN_TRANSFORM_FIXED). Samples carry 2 fraction bits and cosines 13,
+ * as libjpeg's jfdctint. The forward row pass multiplies 16-bit samples by 16-bit cosines and sums them 256 at a
+ * time in 32 bits, which is the pass over pels and the one that vectorizes twice as wide as float; the other passes
+ * carry 32-bit values, scaled per plane, into 64-bit sums. Against the exact transform each pass is off by at most
+ * length * 2^-14 of its largest input, plus 1/8 level of input rounding in the forward pass. Rendered through both
+ * directions, sRGB sources have come out at most one level from FFTW on under 1% of pels; linear light, rounded to
+ * the same quarter level, is up to three levels off in the shadows. */
+void rsn_dct_rowcol_fixed(int,int,int,int,int,rsn_spectrum,rsn_spectrum,double*);
+void rsn_idct_rowcol_fixed(int,int,int,int,int,rsn_spectrum,rsn_spectrum,double*);
+
+/* Fixed-length kernels written by gencodelets at build time for the lengths in CODELETS. dct2 takes n samples to the
+ * n coefficients of the forward row pass, dct3 n coefficients to the n samples of the inverse's; macs is the
+ * multiply-adds either takes. rsn_codelet gives the kernel for length n if it is cheaper than computing count of
+ * the coefficients or samples directly, else NULL. */
+struct rsn_codelet {
+	int length;
+	long macs;
+	void (*dct2)(const rsn_frequency* restrict, rsn_frequency* restrict);
+	void (*dct3)(const rsn_frequency* restrict, rsn_frequency* restrict);
+};
+extern const struct rsn_codelet rsn_codelets[];
+const struct rsn_codelet* rsn_codelet(int n, int count);
+
+/* Spectral windows */
+#define RSN_KAISER_BETA    RSN_SUFFIX_CONSTANT(4.0)
+#define RSN_GAUSSIAN_SIGMA RSN_SUFFIX_CONSTANT(0.5)
+
+/* Returns the weights of the given RSN_SCALING window over a retained band of the given length, DC first.
+ * Vectors are cached per size for the life of the library, or until rsn_release. */
+rsn_spectrum rsn_window(int type, int length);
+void rsn_window_cleanup();
+
+/* Resampling operators: the N x Ns matrix taking a length N signal to length Ns through the forward DCT, the
+ * standard or windowed scale and the normalized inverse, element (n,n') at n*Ns+n'. Cached like the windows. */
+rsn_spectrum rsn_operator(int type, int length, int length_s);
+void rsn_operator_cleanup();
+
+/* An operator cut down to the taps consecutive inputs around each output: output n' takes weights[n'*taps+t] times
+ * input start[n']+t, and input n reaches outputs [first[n],last[n]). error is the most magnitude any output's
+ * weights lose to the cut. Bands are cached like the operators, and freed with them.
+ * rsn_band_taps gives the fewest taps that lose at most the given error, rsn_band_norm the most magnitude any output
+ * of the whole operator has. Both are exact up to RSN_BAND_EXACT multiply-adds of measuring, estimated beyond. */
+typedef struct rsn_band {
+	int type, length, length_s, taps;
+	int* start,* first,* last;
+	rsn_spectrum weights;
+	rsn_frequency error;
+	struct rsn_band* next;
+}* rsn_band;
+rsn_frequency rsn_band_norm(int type, int length, int length_s);
+int rsn_band_taps(int type, int length, int length_s, rsn_frequency error);
+rsn_band rsn_band_create(int type, int length, int length_s, int taps);
+
+/* C[m x n] += A[m x k] B[k x n], A's element (i,p) being A[i*ai+p*ap]; B and C are row-major with leading
+ * dimensions ldb and ldc. Rows of C are split across threads. */
+void rsn_gemm(int m, int n, int k, const rsn_frequency* A, int ai, int ap, const rsn_frequency* B, int ldb,
+              rsn_frequency* C, int ldc, int threads);
+
+/* Colorspace tables, built on first use. rsn_srgb_to_linear maps an sRGB pel to linear light on the same 0-255
+ * scale; rsn_linear_to_srgb maps linear light v in [0,255] back to a pel at index round(v*RSN_LINEAR_STEPS). */
+#define RSN_LINEAR_STEPS 64
+const rsn_frequency* rsn_srgb_to_linear();
+const rsn_pel* rsn_linear_to_srgb();
 
 #endif
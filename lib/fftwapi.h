@@ -18,6 +18,8 @@
 #	define rsn_fftw_plan               RSN_SUFFIX_PRECISION(fftw,_plan)
 #	define rsn_fftw_plan_r2r_3d        RSN_SUFFIX_PRECISION(fftw,_plan_r2r_3d)
 #	define rsn_fftw_plan_many_r2r      RSN_SUFFIX_PRECISION(fftw,_plan_many_r2r)
+#	define rsn_fftw_plan_guru_r2r      RSN_SUFFIX_PRECISION(fftw,_plan_guru_r2r)
+#	define rsn_fftw_iodim              RSN_SUFFIX_PRECISION(fftw,_iodim)
 #	define rsn_fftw_destroy_plan       RSN_SUFFIX_PRECISION(fftw,_destroy_plan)
 #	define rsn_fftw_execute            RSN_SUFFIX_PRECISION(fftw,_execute)
 #	define rsn_fftw_cleanup            RSN_SUFFIX_PRECISION(fftw,_cleanup)
@@ -0,0 +1,171 @@
+/*
+ * Resine - Fourier-based image resampling library.
+ * Copyright 2010-2012 command-Q.org. All rights reserved.
+ * This library is distributed under the terms of the GNU Lesser General Public License, Version 2.
+ *
+ * gencodelets.c - Build-time generator of fixed-length DCT kernels for the native transform.
+ *	Run as gencodelets <length>... > codelets.c; the Makefile does so for the lengths in CODELETS.
+ *	Each length gets the row pass of rsn_dct_rowcol_pruned (2x DCT-II) and of rsn_idct_rowcol_pruned (DCT-III) as
+ *	straight-line code: inputs are folded into sums and differences of mirrored samples, even outputs of an even
+ *	length recurse on the half-length transform of the sums, and what is left is dense blocks of baked cosines, small
+ *	ones unrolled and the rest as fixed-bound loops along contiguous tables for the vectorizer.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Dense blocks up to this many multiply-adds are written out in full */
+#define UNROLL 64
+
+static long macs;
+static int tables;
+
+/* A vector of generated code: name[offset + i*stride] */
+typedef struct {
+	const char* name;
+	int offset, stride;
+} vec;
+
+static void element(vec v, int i) {
+	printf("%s[%d]",v.name,v.offset + i*v.stride);
+}
+
+/* The same at a loop variable */
+static void element_at(vec v, const char* i) {
+	if(v.offset) printf("%s[%d+%d*%s]",v.name,v.offset,v.stride,i);
+	else if(v.stride != 1) printf("%s[%d*%s]",v.name,v.stride,i);
+	else printf("%s[%s]",v.name,i);
+}
+
+/* out[r] = sum over c of in[c] * table[r*cols+c], the table given by the cosine function at (r,c) */
+static void dense(int rows, int cols, vec in, vec out, long double (*cosine)(int,int,int), int length) {
+	if(!rows || !cols) return;
+	int t = tables++;
+	printf("\tstatic const rsn_frequency t%d[%d] = {",t,rows*cols);
+	for(int r = 0; r < rows; r++)
+		for(int c = 0; c < cols; c++)
+			printf("%s%sK(%#.21Lg)",r+c ? "," : "",c ? "" : "\n\t\t",cosine(length,r,c));
+	printf("\n\t};\n");
+	macs += rows*cols;
+
+	if(rows*cols <= UNROLL) {
+		for(int r = 0; r < rows; r++) {
+			printf("\t");
+			element(out,r);
+			printf(" = ");
+			for(int c = 0; c < cols; c++) {
+				printf("%s",c ? " + " : "");
+				element(in,c);
+				printf("*t%d[%d]",t,r*cols+c);
+			}
+			printf(";\n");
+		}
+	}
+	else {
+		printf("\tfor(int r = 0; r < %d; r++) {\n",rows);
+		printf("\t\trsn_frequency s = 0;\n");
+		printf("\t\tfor(int c = 0; c < %d; c++)\n",cols);
+		printf("\t\t\ts += ");
+		element_at(in,"c");
+		printf(" * t%d[r*%d+c];\n\t\t",t,cols);
+		element_at(out,"r");
+		printf(" = s;\n");
+		printf("\t}\n");
+	}
+}
+
+/* Entries of the dense blocks. For length L, sample i and frequency u meet in cos(pi*(2i+1)*u / 2L); the forward
+   blocks are doubled and the inverse halves DC, which is always column 0 of the even block it ends up in. */
+static long double arg(int length, int i, int u) { return acosl(-1) * (2*i+1) * u / (2.0L*length); }
+static long double dct2_even(int length, int k, int i) { return 2*cosl(arg(length,i,2*k)); }
+static long double dct2_odd(int length, int k, int i) { return 2*cosl(arg(length,i,2*k+1)); }
+static long double dct3_even(int length, int i, int k) { return cosl(arg(length,i,2*k)) * (k ? 1 : 0.5L); }
+static long double dct3_odd(int length, int i, int k) { return cosl(arg(length,i,2*k+1)); }
+
+/* Outputs 2k of a length L DCT-II only depend on the sums a[i] = x[i] + x[L-1-i] (with the middle sample alone for
+   odd L), and for even L are the length L/2 transform of them. Outputs 2k+1 only depend on the differences. */
+static void dct2(int level, int length, vec in, vec out) {
+	int half = length/2;
+	char a[16], d[16];
+	sprintf(a,"a%d",level);
+	sprintf(d,"d%d",level);
+	printf("\trsn_frequency %s[%d]",a,length - half);
+	if(half) printf(", %s[%d]",d,half);
+	printf(";\n");
+	for(int i = 0; i < half; i++) {
+		printf("\t%s[%d] = ",a,i); element(in,i); printf(" + "); element(in,length-1-i); printf(";\n");
+		printf("\t%s[%d] = ",d,i); element(in,i); printf(" - "); element(in,length-1-i); printf(";\n");
+	}
+	if(length % 2) {
+		printf("\t%s[%d] = ",a,half); element(in,half); printf(";\n");
+	}
+
+	vec even = {out.name,out.offset,out.stride*2}, odd = {out.name,out.offset + out.stride,out.stride*2};
+	if(length % 2) dense(length - half,length - half,(vec){a,0,1},even,dct2_even,length);
+	else dct2(level+1,half,(vec){a,0,1},even);
+	dense(half,half,(vec){d,0,1},odd,dct2_odd,length);
+}
+
+/* The transpose: samples i and L-1-i are the even part's value plus and minus the odd part's */
+static void dct3(int level, int length, vec in, vec out) {
+	int half = length/2;
+	char e[16], o[16], E[24], O[24];
+	sprintf(e,"e%d",level);
+	sprintf(o,"o%d",level);
+	printf("\trsn_frequency %s[%d], %s_[%d]",e,length - half,e,length - half);
+	if(half) printf(", %s[%d], %s_[%d]",o,half,o,half);
+	printf(";\n");
+	for(int k = 0; k < length - half; k++) {
+		printf("\t%s[%d] = ",e,k); element(in,2*k); printf(";\n");
+	}
+	for(int k = 0; k < half; k++) {
+		printf("\t%s[%d] = ",o,k); element(in,2*k+1); printf(";\n");
+	}
+
+	sprintf(E,"%s_",e);
+	sprintf(O,"%s_",o);
+	if(length % 2) dense(length - half,length - half,(vec){e,0,1},(vec){E,0,1},dct3_even,length);
+	else dct3(level+1,half,(vec){e,0,1},(vec){E,0,1});
+	dense(half,half,(vec){o,0,1},(vec){O,0,1},dct3_odd,length);
+
+	for(int i = 0; i < half; i++) {
+		printf("\t"); element(out,i); printf(" = %s[%d] + %s[%d];\n",E,i,O,i);
+		printf("\t"); element(out,length-1-i); printf(" = %s[%d] - %s[%d];\n",E,i,O,i);
+	}
+	if(length % 2) {
+		printf("\t"); element(out,half); printf(" = %s[%d];\n",E,half);
+	}
+}
+
+int main(int argc, char** argv) {
+	int count = argc - 1;
+	int lengths[count > 0 ? count : 1];
+	long cost[count > 0 ? count : 1];
+
+	printf("/* Generated by gencodelets; do not edit. */\n\n");
+	printf("#include \"dsp.h\"\n\n");
+	printf("#define K(c) RSN_SUFFIX_CONSTANT(c)\n");
+	for(int n = 0; n < count; n++) {
+		lengths[n] = strtol(argv[n+1],NULL,10);
+		if(lengths[n] < 1) {
+			fprintf(stderr,"gencodelets: bad length %s\n",argv[n+1]);
+			return 1;
+		}
+		macs = 0;
+		printf("\nstatic void rsn_dct2_%d(const rsn_frequency* restrict x, rsn_frequency* restrict X) {\n",lengths[n]);
+		dct2(1,lengths[n],(vec){"x",0,1},(vec){"X",0,1});
+		printf("}\n");
+		cost[n] = macs;
+
+		printf("\nstatic void rsn_dct3_%d(const rsn_frequency* restrict X, rsn_frequency* restrict x) {\n",lengths[n]);
+		dct3(1,lengths[n],(vec){"X",0,1},(vec){"x",0,1});
+		printf("}\n");
+	}
+
+	printf("\nconst struct rsn_codelet rsn_codelets[] = {\n");
+	for(int n = 0; n < count; n++)
+		printf("\t{%d,%ld,rsn_dct2_%d,rsn_dct3_%d},\n",lengths[n],cost[n],lengths[n],lengths[n]);
+	printf("\t{0}\n};\n");
+	return 0;
+}
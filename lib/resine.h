@@ -62,6 +62,8 @@ typedef rsn_spectrum** rsn_wisdom;
 #define RSN_TRANSFORM_NATIVE   0
 #define RSN_TRANSFORM_FFTW     1
 #define RSN_TRANSFORM_KISS     2
+/* The native transform in fixed point, for 8-bit sources. AUTO and HYBRID always run it spectrally. */
+#define RSN_TRANSFORM_FIXED    3
 
 #if HAS_FFTW
 #	define RSN_TRANSFORM_DEFAULT RSN_TRANSFORM_FFTW
@@ -72,31 +74,102 @@ typedef rsn_spectrum** rsn_wisdom;
 #endif
 
 #define RSN_SCALING_STANDARD 0
+/* Apodized variants of the standard crop, tapering the retained coefficients toward the cutoff to reduce ringing */
+#define RSN_SCALING_LANCZOS  1
+#define RSN_SCALING_HANN     2
+#define RSN_SCALING_KAISER   3
+#define RSN_SCALING_GAUSSIAN 4
+
+#define RSN_PADDING_EDGE   0
+#define RSN_PADDING_MIRROR 1
+
+/* Alpha handling, fused into packing the input. With DROP and FLATTEN the input carries one more channel than
+ * info.channels, a trailing alpha that is ignored (see rsn_opaque) or composited over config.background.
+ * PREMULTIPLY keeps alpha as the last channel but resamples color multiplied by it, dividing it back out on output,
+ * so transparent pixels don't bleed their color into the edges of opaque ones. Without an alpha, i.e. with an odd
+ * info.channels, PREMULTIPLY is treated as KEEP. */
+#define RSN_ALPHA_KEEP        0
+#define RSN_ALPHA_DROP        1
+#define RSN_ALPHA_FLATTEN     2
+#define RSN_ALPHA_PREMULTIPLY 3
+
+/* Colorspace the transform runs in, converted to and from sRGB-encoded pels while packing and unpacking.
+ * LINEAR resamples in linear light; YCBCR in JFIF YCbCr (RGB only). A trailing alpha is never converted. */
+#define RSN_COLORSPACE_SRGB   0
+#define RSN_COLORSPACE_LINEAR 1
+#define RSN_COLORSPACE_YCBCR  2
+
+/* Execution engine for resine and resine_data. OPERATOR skips the spectra altogether, applying the 1-D operators
+ * that the forward transform, scaling and inverse amount to along each axis; it is cheaper for small outputs, so
+ * AUTO picks it by cost. SPECTRAL, the default, always transforms, and is needed whenever freq_image or freq_image_s
+ * are used; the other engines leave them NULL.
+ * BANDED is approximate and never picked by AUTO: the operators are cut down to the fewest taps around each output
+ * that keep every output pel within config.tolerance levels of OPERATOR's, then convolved in one pass over the
+ * input rows. The bound holds in the colorspace resampled in, before premultiplication is undone; for very long
+ * operators it is estimated from a sample of outputs rather than checked on all of them.
+ * HYBRID is AUTO with BANDED among the choices, which it takes when the bands are short enough to be cheaper, as
+ * they are near unity scale with a window (the unwindowed crop rings too far for a short band to stay exact). */
+#define RSN_ENGINE_AUTO     0
+#define RSN_ENGINE_SPECTRAL 1
+#define RSN_ENGINE_OPERATOR 2
+#define RSN_ENGINE_BANDED   3
+#define RSN_ENGINE_HYBRID   4
 
 #define RSN_GREED_LEAN            0
 #define RSN_GREED_PREALLOC        1
 #define RSN_GREED_RETAIN          2
 #define RSN_GREED_PREALLOC_RETAIN 3
 
+/* background is 0xRRGGBB; channel z of a flattened image takes component z (gray takes RR) */
 typedef struct {
-	int transform, scaling, verbosity, threads, greed;
+	int transform, scaling, verbosity, threads, greed, padding, alpha, colorspace, engine;
+	unsigned background;
+	double tolerance;
 } rsn_config;
 
+/* Placement of the transformed width x height region within the input image, for cropping without a copy.
+ * x,y is the region's offset in the input and width,height are the input's own dimensions. The region may extend
+ * past the input's edges, which are then padded according to config.padding.
+ * All zero (the default) means the region is the whole input. */
+typedef struct {
+	int x, y, width, height;
+} rsn_rect;
+
 typedef struct {
 	rsn_config config;
 	int channels, width, height, width_s, height_s;
+	rsn_rect source;
 } rsn_info;
 typedef rsn_info* rsn_infop;
 
+/* Row reader: fills line with row y of the input (width*channels interleaved pels plus any alpha dropped per
+ * config.alpha, in input coordinates).
+ * Rows are requested in increasing order and only those needed, so a reader may have to skip ahead. */
+typedef void (*rsn_reader)(void* reader, int y, rsn_line line);
+
+/* Row writer: receives row y of the output (width_s*channels interleaved pels) once it is final, in order.
+ * The line is only valid for the duration of the call. */
+typedef void (*rsn_writer)(void* writer, int y, rsn_line line);
+
+/* When read is set, rsn_decompose pulls the input through it and image is not used.
+ * When write is set, rsn_recompose pushes the output through it and image_s is not allocated.
+ * An image_s set by the caller before rsn_recompose is written in place; clear it again before rsn_destroy. */
 typedef struct {
 	rsn_image    image,      image_s;
 	rsn_spectrum freq_image, freq_image_s;
+	rsn_reader   read;
+	void*        reader;
+	rsn_writer   write;
+	void*        writer;
 } rsn_data;
 typedef rsn_data* rsn_datap;
 
 /* Returns the default configuration, suitable for most cases */
 rsn_config rsn_defaults();
 
+/* Nonzero when the trailing channel of every input pixel is 255, so it can be dropped with RSN_ALPHA_DROP */
+int rsn_opaque(rsn_info,rsn_image);
+
 /* Returns the input image scaled to the dimensions given in the info struct. */
 rsn_image resine(rsn_info,rsn_image);
 
@@ -107,7 +180,18 @@ rsn_datap rsn_init(rsn_info,rsn_image);
 /* High-level wrapper for forward transform, scale, inverse transform */
 void resine_data(rsn_info,rsn_datap);
 
-/* Mid-level transform wrappers */
+/* Returns one image per entry of widths/heights (count of each), scaled from a single forward transform.
+ * The output dimensions in the info struct are ignored. Inverse transforms run concurrently when threaded.
+ * The array should be freed by the caller along with each image (rsn_free_array with the matching height). */
+rsn_image* resine_multi(rsn_info,rsn_image,int count,const int* widths,const int* heights);
+
+/* As resine_multi, for a data container constructed with rsn_init.
+ * Output images are written to out, which must hold count entries; data->image_s is not touched. */
+void resine_data_multi(rsn_info,rsn_datap,int count,const int* widths,const int* heights,rsn_image* out);
+
+/* Mid-level transform wrappers.
+ * When downscaling, rsn_decompose only computes the coefficients that survive rsn_scale (the lowest
+ * min(height,height_s) x min(width,width_s) block of each plane); the rest of freq_image is undefined. */
 void rsn_decompose(rsn_info,rsn_datap);
 void rsn_scale(rsn_info,rsn_datap);
 void rsn_recompose(rsn_info,rsn_datap);
@@ -120,6 +204,41 @@ rsn_image rsn_cleanup(rsn_info,rsn_datap);
  * Like rsn_cleanup, the data pointer is invalid after this call. */
 void rsn_destroy(rsn_info,rsn_datap);
 
+/* Frees the windows and operators Resine keeps between calls. They are rebuilt when next needed, so this only returns memory,
+ * and no other call into Resine may be running at the time. */
+void rsn_release();
+
+
+/* Coefficient cache
+ * A decomposed spectrum written to disk so that new sizes can later be rendered without the forward transform.
+ * Native files hold coefficients at library precision and are memory-mapped and used in place; quantized files
+ * hold 16 bit coefficients (DC at full precision) and are decoded on open. */
+#define RSN_CACHE_NATIVE    0
+#define RSN_CACHE_QUANTIZED 1
+
+typedef struct rsn_cache* rsn_cache;
+
+/* Writes the coefficients retained for info's output size, i.e. the lowest min(height,height_s) x min(width,width_s)
+ * block, so the output size doubles as the truncation. data must have been through rsn_decompose.
+ * Returns nonzero on failure. */
+int rsn_cache_write(rsn_info,rsn_datap,int encoding,const char* filename);
+
+/* Decomposes the image and writes its cache in one step. */
+int resine_cache(rsn_info,rsn_image,int encoding,const char* filename);
+
+/* Returns NULL if the file can't be read, is not a cache, has dimensions its payload does not hold, or is native at
+ * a different precision. */
+rsn_cache rsn_cache_open(const char*);
+
+/* Source image description, with the output size set to the source size and config.alpha and config.colorspace
+ * to the modes it was written with. */
+rsn_info rsn_cache_info(rsn_cache);
+
+/* Returns the cached image at the given size. Sizes past the cached block are treated as an upscale of it.
+ * config.alpha and config.colorspace are ignored in favor of the cache's own. */
+rsn_image rsn_cache_render(rsn_cache,rsn_config,int width_s,int height_s);
+void rsn_cache_close(rsn_cache);
+
 
 /* Utility functions */
 
@@ -3,11 +3,12 @@
  * This example code is distributed under no claim of copyright.
  *
  * resine.c - Example command-line application using libresine.
- *	Reads in an image file of type PNG or JPEG, scales it, and writes it back to the format of your choice.
+ *	Reads in an image file of type PNG, JPEG or PNM, scales it, and writes it back to the format of your choice.
  */
 
 #include "image.h"
 
+#include <ctype.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -16,9 +17,14 @@
 #include <getopt.h>
 #include <inttypes.h>
 
+#include <png.h>
+#include <zlib.h>
+
 int main(int argc, char **argv) {
 
-	rsn_info info = {rsn_defaults(),0,0,0,0,0};
+	rsn_info info = {.config = rsn_defaults()};
+	/* The spectra are only wanted for -g, -p and -c, which go back to the spectral engine below, as does -T */
+	info.config.engine = RSN_ENGINE_AUTO;
 
 	if(argc < 2) {
 		printf("Resine - Fourier-based image resampling library.\n"
@@ -36,8 +42,8 @@ int main(int argc, char **argv) {
 		       "\n"
 		       "Usage: resine [options] infile outfile\n"
 		       "\n"
-		       "infile: PNG or JPEG, 8-32 bit color.\n"
-		       "outfile: PNG or JPEG, same bitdepth as input. Outfile may be ommitted, but nothing will be written to disk.\n"
+		       "infile: PNG or JPEG, 8-32 bit color, 8-bit binary PGM/PPM/PAM (memory-mapped), or a coefficient cache (.rsn) written with -c/-C.\n"
+		       "outfile: PNG, JPEG or PGM/PPM/PAM (P5/P6 where possible, else PAM), same bitdepth as input. Outfile may be ommitted, but nothing will be written to disk.\n"
 		       "\n"
 		       "options:\n"
 		       "\n"
@@ -51,6 +57,8 @@ int main(int argc, char **argv) {
 		       "\t-w <int>\t New width\n"
 		       "\t-h <int>\t New height\n"
 		       "\n"
+		       "\t-r <x,y,w,h>\t Region: Crop to w x h at x,y; scaling factors apply to the region\n"
+		       "\n"
 		       "Resine options:\n"
 		       "\n"
 		       "\t-T <int>\t Transform type [%d]\n"
@@ -61,23 +69,58 @@ int main(int argc, char **argv) {
 #if HAS_KISS
 		       "\t        \t\t- 2: KISS FFT\n"
 #endif
+		       "\t        \t\t- 3: Native in fixed point, for 8-bit sources (SLOW unless built with CFLAGS=-O3)\n"
+		       "\t-S <int>\t Scaling - Treatment of the retained coefficients [%d]\n"
+		       "\t        \t\t- 0: Standard - Hard crop/zero-pad\n"
+		       "\t        \t\t- 1: Lanczos - Sinc (sigma) window\n"
+		       "\t        \t\t- 2: Hann window\n"
+		       "\t        \t\t- 3: Kaiser window\n"
+		       "\t        \t\t- 4: Gaussian roll-off\n"
+		       "\t-P <int>\t Padding - Fill past the input edges for regions that extend beyond them [%d]\n"
+		       "\t        \t\t- 0: Edge - Repeat the outermost pixels\n"
+		       "\t        \t\t- 1: Mirror - Reflect about the edges\n"
 		       "\t-G <int>\t Greed - Memory consumption/speed trade-offs [%d]\n"
 		       "\t        \t\t- 0: Lean - Allocate and free memory on the fly\n"
 		       "\t        \t\t- 1: Prealloc - Preallocate image data\n"
 		       "\t        \t\t- 2: Retain - Don't free any memory until rsn_destroy is called\n"
 		       "\t        \t\t- 3: Prealloc and retain\n"
+		       "\t-L <int>\t Colorspace - Resample in [%d]\n"
+		       "\t        \t\t- 0: sRGB - The pels as stored\n"
+		       "\t        \t\t- 1: Linear light - Gamma-correct\n"
+		       "\t        \t\t- 2: YCbCr (RGB only)\n"
+		       "\t-E <int>\t Engine - How the resampling is computed [%d]\n"
+		       "\t        \t\t- 0: Auto - Whichever is estimated to be faster, or spectral if -T is given\n"
+		       "\t        \t\t- 1: Spectral - Forward transform, scale and inverse transform\n"
+		       "\t        \t\t- 2: Operator - Equivalent 1-D resampling matrices applied as products (small outputs)\n"
+		       "\t        \t\t- 3: Banded - Approximate: the matrices cut down to the taps that matter, as convolutions\n"
+		       "\t        \t\t- 4: Hybrid - As auto, also considering banded (fast near unity scale with -S)\n"
+		       "\t-e <float>\t Most a pel may differ from the exact result with the banded engine, in levels [%g]\n"
 #if RSN_IS_THREADED
 		       "\t-t <int>\t Number of threads to use [%d]\n"
 #endif
 		       "\t-g <filename>\t Graph: Draw spectrogram to file <filename>.png (NOTE: Bumps Greed level to Retain if necessary).\n"
 		       "\t-p <filename>\t Print: Dump transform data into file <filename>.\n"
+		       "\t-c <filename>\t Cache: Write the retained coefficients to <filename> (name it .rsn to render from it later) (NOTE: Bumps Greed level to Retain if necessary).\n"
+		       "\t-C <filename>\t As -c, quantized to 16 bits.\n"
 		       "\t-v      \t Verbose: Print duration of transforms.\n"
 		       "\n"
 		       "Command-line options:\n"
 		       "\n"
 		       "\t-q <int>\t JPEG compression quality (0-100) [90]\n"
+		       "\t-A      \t Resample color premultiplied by alpha, avoiding fringes at transparent edges\n"
+		       "\t-B <hex>\t Background (RRGGBB) that alpha is flattened against for JPEG output [000000]\n"
+		       "\t-J      \t Fully decode JPEG input, even for reductions of 2x or more (normally decoded at reduced scale)\n"
+		       "\t-z <int>\t PNG zlib compression level (0-9) [libpng default]\n"
+		       "\t-F <list>\t PNG filters to choose between: Comma-separated from none,sub,up,avg,paeth or all [all]\n"
+		       "\t-Z <preset>\t PNG compression preset, setting level, filters and zlib strategy\n"
+		       "\t        \t\t- fast: Level 1, sub filter, run-length matching\n"
+		       "\t        \t\t- small: Level 9, all filters\n"
+		       "\t        \t\t- store: No compression or filtering\n"
+#if RSN_IS_THREADED
+		       "\t        \t PNG output is deflated in parallel strips when threaded\n"
+#endif
 		       "\n",
-		       RSN_VERSION,RSN_PRECISION_STR,(uintptr_t)sizeof(rsn_frequency),info.config.transform,info.config.greed
+		       RSN_VERSION,RSN_PRECISION_STR,(uintptr_t)sizeof(rsn_frequency),info.config.transform,info.config.scaling,info.config.padding,info.config.greed,info.config.colorspace,info.config.engine,info.config.tolerance
 #if RSN_IS_THREADED
 		       ,info.config.threads
 #endif
@@ -87,87 +130,200 @@ int main(int argc, char **argv) {
 
 	int c, in_type=RSN_IMGTYPE_NONE, out_type=RSN_IMGTYPE_NONE, jpeg_q=90;
 	float sx = 1.0,sy = 1.0;
-	char* print = NULL,* graph = NULL;
+	char* print = NULL,* graph = NULL,* cache = NULL;
+	int cache_encoding = RSN_CACHE_NATIVE;
+	rsn_rect region = {0,0,0,0};
+	bool dct_domain = true, premultiply = false, transform = false, engine = false;
+	png_options png = PNG_OPTIONS_DEFAULT;
+	static const char* filters[] = {"none","sub","up","avg","paeth"};
 
-	while((c = getopt(argc,argv,"s:x:y:w:h:t:T:G:p:g:vq:")) != -1)
+	while((c = getopt(argc,argv,"s:x:y:w:h:r:t:T:S:P:G:L:E:e:p:g:c:C:vq:Jz:F:Z:B:A")) != -1)
 		switch (c) {
 			case 's' : sx = sy = strtof(optarg,NULL);                  break;
 			case 'x' : sx = strtof(optarg,NULL);                       break;
 			case 'y' : sy = strtof(optarg,NULL);                       break;
 			case 'w' : info.width_s = strtol(optarg,NULL,10);          break;
 			case 'h' : info.height_s = strtol(optarg,NULL,10);         break;
-			case 'T' : info.config.transform = strtol(optarg,NULL,10); break;
+			case 'r' : sscanf(optarg,"%d,%d,%d,%d",&region.x,&region.y,&region.width,&region.height); break;
+			case 'T' : info.config.transform = strtol(optarg,NULL,10); transform = true; break;
+			case 'S' : info.config.scaling = strtol(optarg,NULL,10);   break;
+			case 'P' : info.config.padding = strtol(optarg,NULL,10);   break;
 			case 'G' : info.config.greed = strtol(optarg,NULL,10);     break;
+			case 'L' : info.config.colorspace = strtol(optarg,NULL,10); break;
+			case 'E' : info.config.engine = strtol(optarg,NULL,10);    engine = true; break;
+			case 'e' : info.config.tolerance = strtod(optarg,NULL);    break;
 			case 't' : info.config.threads = strtol(optarg,NULL,10);   break;
 			case 'p' : print = optarg;                                 break;
 			case 'g' : graph = optarg;                                 break;
+			case 'c' : cache = optarg;                                 break;
+			case 'C' : cache = optarg; cache_encoding = RSN_CACHE_QUANTIZED; break;
 			case 'v' : info.config.verbosity = 1;                      break;
 			case 'q' : jpeg_q = strtol(optarg,NULL,10);                break;
+			case 'A' : premultiply = true;                             break;
+			case 'B' : info.config.background = strtoul(optarg,NULL,16);  break;
+			case 'J' : dct_domain = false;                             break;
+			case 'z' : png.level = strtol(optarg,NULL,10);             break;
+			case 'F' :
+				png.filters = 0;
+				for(char* f = strtok(optarg,","); f; f = strtok(NULL,","))
+					for(int i = 0; i < 5; i++)
+						if(!strcasecmp(f,filters[i]) || !strcasecmp(f,"all")) png.filters |= PNG_FILTER_NONE << i;
+				break;
+			case 'Z' :
+				if(!strcasecmp(optarg,"fast"))  png = (png_options){1,PNG_FILTER_SUB,Z_RLE,png.threads};
+				if(!strcasecmp(optarg,"small")) png = (png_options){9,PNG_ALL_FILTERS,Z_FILTERED,png.threads};
+				if(!strcasecmp(optarg,"store")) png = (png_options){0,PNG_FILTER_NONE,Z_DEFAULT_STRATEGY,png.threads};
+				break;
 		}
-	if(graph && !(info.config.greed & RSN_GREED_RETAIN)) info.config.greed = RSN_GREED_RETAIN;
+	if((graph || cache) && !(info.config.greed & RSN_GREED_RETAIN)) info.config.greed = RSN_GREED_RETAIN;
+	/* Only the spectral engine has coefficients to show or keep, and a transform asked for is one to run */
+	if(graph || print || cache || (transform && !engine)) info.config.engine = RSN_ENGINE_SPECTRAL;
+#if RSN_IS_THREADED
+	png.threads = info.config.threads;
+#endif
 	char* infile = argv[optind++];
 	char* outfile = NULL;
 	if(optind < argc) outfile = argv[optind];
 	if(!strncasecmp(strrchr(infile,'.'),".jp",3)) in_type = RSN_IMGTYPE_JPEG;
 	else if(!strncasecmp(strrchr(infile,'.'),".png",4)) in_type = RSN_IMGTYPE_PNG;
+	else if(!strncasecmp(strrchr(infile,'.'),".p",2) && strlen(strrchr(infile,'.')) == 4 && tolower(strrchr(infile,'.')[3]) == 'm') in_type = RSN_IMGTYPE_PNM;
 	if(outfile) {
 		if(!strncasecmp(strrchr(outfile,'.'),".jp",3)) out_type = RSN_IMGTYPE_JPEG;
 		else if(!strncasecmp(strrchr(outfile,'.'),".png",4)) out_type = RSN_IMGTYPE_PNG;
+		else if(!strncasecmp(strrchr(outfile,'.'),".p",2) && strlen(strrchr(outfile,'.')) == 4 && tolower(strrchr(outfile,'.')[3]) == 'm') out_type = RSN_IMGTYPE_PNM;
 	}
 
-	rsn_image img = NULL;
+	/* Render straight from a coefficient cache */
+	if(!strncasecmp(strrchr(infile,'.'),".rsn",4)) {
+		rsn_cache cached = rsn_cache_open(infile);
+		if(!cached) {
+			fprintf(stderr,"Could not read coefficient cache %s.\n",infile);
+			return 1;
+		}
+		rsn_info source = rsn_cache_info(cached);
+		info.channels = source.channels;
+		info.width = source.width;
+		info.height = source.height;
+		/* The planes are in whatever alpha mode and colorspace they were written in, not those given now */
+		info.config.alpha = source.config.alpha;
+		info.config.colorspace = source.config.colorspace;
+		if(!info.height_s) info.height_s = round(info.height*sx);
+		if(!info.width_s) info.width_s = round(info.width*sy);
+		rsn_image out = rsn_cache_render(cached,info.config,info.width_s,info.height_s);
+		switch(out_type) {
+			case  RSN_IMGTYPE_PNG : write_png_file(info,outfile,out,png);     break;
+			case RSN_IMGTYPE_JPEG : write_jpeg_file(info,outfile,out,jpeg_q); break;
+			case  RSN_IMGTYPE_PNM : write_pnm_file(info,outfile,out);         break;
+		}
+		rsn_free_array(RSN_TRANSFORM_NONE,info.height_s,(void***)&out);
+		rsn_cache_close(cached);
+		rsn_release();
+		return 0;
+	}
+
+	/* Rows are streamed into the library as they are decoded, unless the whole image has to be seen first:
+	   an alpha channel kept for PNG output is dropped only if it turns out to be fully opaque. */
+	image_reader reader = NULL;
 	switch(in_type) {
-		case RSN_IMGTYPE_PNG  : img = read_png_file(&info,infile);  break;
-		case RSN_IMGTYPE_JPEG : img = read_jpeg_file(&info,infile); break;
+		case RSN_IMGTYPE_PNG  : reader = open_png_reader(&info,infile);  break;
+		case RSN_IMGTYPE_JPEG : reader = open_jpeg_reader(&info,infile); break;
+		case RSN_IMGTYPE_PNM  : break;
 		case RSN_IMGTYPE_NONE :
-		default               : fprintf(stderr,"Image is not a supported type (PNG, JPEG).\n"); return 1; // Unsupported type
+		default               : fprintf(stderr,"Image is not a supported type (PNG, JPEG, PNM).\n"); return 1; // Unsupported type
+	}
+	if(reader && !(info.channels % 2) && out_type != RSN_IMGTYPE_JPEG) {
+		close_image_reader(reader);
+		reader = NULL;
 	}
-	if(!info.height_s) info.height_s = round(info.height*sx);
-	if(!info.width_s) info.width_s = round(info.width*sy);
 
-	/* Flatten alpha channel when necessary */
-	int z,y,x;
-	bool flatten = !(info.channels % 2);
-	if(out_type == RSN_IMGTYPE_JPEG && flatten) {
-		info.channels--;
-		for(y = 0; y < info.height; y++) {
-			for(x = 0; x < info.width; x++)
-				for(z = 0; z < info.channels; z++)
-					img[y][x*info.channels+z] = img[y][x*(info.channels+1)+z] * img[y][x*(info.channels+1)+info.channels] / 255.0;
-			realloc(img[y],sizeof(rsn_pel)*info.width*info.channels);
+	/* Large JPEG reductions are decoded at the smallest 1/2, 1/4 or 1/8 scale still covering the target, leaving
+	   resine only the fractional remainder. At 1/8 the DC coefficients alone suffice, without any IDCT. */
+	if(reader && in_type == RSN_IMGTYPE_JPEG && dct_domain && !region.width) {
+		int height_s = info.height_s ? info.height_s : round(info.height*sx);
+		int width_s = info.width_s ? info.width_s : round(info.width*sy);
+		int denom = 8;
+		while(denom > 1 && (width_s*denom > info.width || height_s*denom > info.height))
+			denom /= 2;
+		image_reader scaled = NULL;
+		if(denom == 8) scaled = open_jpeg_dc_reader(&info,infile);
+		if(!scaled && denom > 1) scaled = open_jpeg_scaled_reader(&info,infile,denom);
+		if(scaled) {
+			close_image_reader(reader);
+			reader = scaled;
+			info.height_s = height_s;
+			info.width_s = width_s;
 		}
-		flatten = false;
 	}
-	for(y = 0; flatten && y < info.height; y++)
-		for(x = info.channels-1; flatten && x < info.width*info.channels; x+= info.channels)
-			if(img[y][x] != 255) flatten = false;
-	if(flatten) {
-		info.channels--;
-		for(y = 0; y < info.height; y++) {
-			for(x = 0; x < info.width; x++)
-				for(z = 0; z < info.channels; z++)
-					img[y][x*info.channels+z] = img[y][x*(info.channels+1)+z];
-			realloc(img[y],sizeof(rsn_pel)*info.width*info.channels);
+
+	/* PNM input is used in place from its mapping */
+	rsn_image img = NULL;
+	image_map in_map = NULL;
+	if(!reader)
+		switch(in_type) {
+			case RSN_IMGTYPE_PNG  : img = read_png_file(&info,infile);  break;
+			case RSN_IMGTYPE_JPEG : img = read_jpeg_file(&info,infile); break;
+			case RSN_IMGTYPE_PNM  : img = (in_map = map_pnm_file(&info,infile))->image; break;
 		}
+
+	/* Alpha is composited over the background for JPEG output and dropped when fully opaque, both by the library
+	   as it packs the input */
+	if(!(info.channels % 2)) {
+		if(out_type == RSN_IMGTYPE_JPEG) info.config.alpha = RSN_ALPHA_FLATTEN;
+		else if(rsn_opaque(info,img)) info.config.alpha = RSN_ALPHA_DROP;
+		else if(premultiply) info.config.alpha = RSN_ALPHA_PREMULTIPLY;
+		if(info.config.alpha == RSN_ALPHA_DROP || info.config.alpha == RSN_ALPHA_FLATTEN) info.channels--;
 	}
 
+	/* The library reads the region straight out of img */
+	if(region.width && region.height) {
+		info.source = (rsn_rect){region.x,region.y,info.width,info.height};
+		info.width = region.width;
+		info.height = region.height;
+	}
+	if(!info.height_s) info.height_s = round(info.height*sx);
+	if(!info.width_s) info.width_s = round(info.width*sy);
+
 	rsn_datap data = rsn_init(info,img);
+	if(reader) {
+		data->read = read_image_row;
+		data->reader = reader;
+	}
+	/* Output rows are encoded as the inverse transform produces them, or unpacked straight into a mapped PNM */
+	image_writer writer = NULL;
+	image_map out_map = NULL;
+	switch(out_type) {
+		case  RSN_IMGTYPE_PNG : writer = open_png_writer(info,outfile,png);     break;
+		case RSN_IMGTYPE_JPEG : writer = open_jpeg_writer(info,outfile,jpeg_q); break;
+		case  RSN_IMGTYPE_PNM : out_map = create_pnm_file(info,outfile);        break;
+	}
+	if(out_map) {
+		rsn_free_array(RSN_TRANSFORM_NONE,info.height_s,(void***)&data->image_s);
+		data->image_s = out_map->image;
+	}
+	if(writer) {
+		data->write = write_image_row;
+		data->writer = writer;
+	}
 	resine_data(info,data);
+	if(reader) close_image_reader(reader);
+	if(writer) close_image_writer(writer);
 
+	if(cache && rsn_cache_write(info,data,cache_encoding,cache)) fprintf(stderr,"Could not write coefficient cache %s.\n",cache);
 	if(print) print_spectrum(info.channels,info.height_s,info.width_s,2,data->freq_image_s,print);
 	if(graph) {
 		rsn_image specta = spectrogram(info.channels,info.height_s,info.width_s,data->freq_image_s);
-		write_png_file(info,graph,specta);
+		write_png_file(info,graph,specta,png);
 		rsn_free_array(RSN_TRANSFORM_NONE,info.height_s,(void***)&specta);
 	}
 
-	switch(out_type) {
-		case  RSN_IMGTYPE_PNG : write_png_file(info,outfile,data->image_s);         break;
-		case RSN_IMGTYPE_JPEG : write_jpeg_file(info,outfile,data->image_s,jpeg_q); break;
+	if(out_map) {
+		data->image_s = NULL;
+		unmap_image(out_map);
 	}
-
 	rsn_destroy(info,data);
-	rsn_free_array(RSN_TRANSFORM_NONE,info.height,(void***)&img);
+	rsn_release();
+	if(in_map) unmap_image(in_map);
+	else if(img) rsn_free_array(RSN_TRANSFORM_NONE,info.source.height ? info.source.height : info.height,(void***)&img);
 
 	return 0;
 }